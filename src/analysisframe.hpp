@@ -0,0 +1,66 @@
+#ifndef ANALYSIS_FRAME_HPP
+#define ANALYSIS_FRAME_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "spectrumframe.hpp"
+#include "levelmeter.hpp"
+#include "scopeframe.hpp"
+
+
+// Everything the GUI draws for one hop of the analysis, computed from the
+// same samples : the levels cover the frame the spectra were computed on.
+// The layout is fixed: the spectra are allocated once with every channel,
+// so the frame is filled in place and never reallocated.
+struct AnalysisFrame {
+    static const size_t MAX_NUMBER_OF_CHANNELS = 16;
+    static const size_t MAX_NUMBER_OF_MONITORED_BINS = 8;
+
+    AnalysisFrame() {
+        clearLevels();
+    }
+    explicit AnalysisFrame(size_t numberOfBins) :
+        spectra(numberOfBins, MAX_NUMBER_OF_CHANNELS)
+    {
+        clearLevels();
+    }
+
+    uint64_t sequenceNumber = 0;   // consecutive frames differ by one
+
+    // When the last sample of the frame was captured. adcTime is on the
+    // clock of the PortAudio stream (PaStreamCallbackTimeInfo), captureTime
+    // is the same instant on the steady clock, which the other threads can
+    // compare with now() to get the end-to-end latency.
+    double adcTime = 0.0;
+    std::chrono::steady_clock::time_point captureTime;
+
+    size_t numberOfChannels = 1;
+    // in dBFS, see levelmeter.hpp
+    float rmsDbfs[MAX_NUMBER_OF_CHANNELS];
+    float peakDbfs[MAX_NUMBER_OF_CHANNELS];       // largest absolute sample
+    float truePeakDbfs[MAX_NUMBER_OF_CHANNELS];   // largest absolute value, between the samples too
+    SpectrumFrame spectra;
+
+    // The bins followed sample by sample by a SlidingDFT, on the scale of
+    // the spectra: the largest amplitude each one reached during the
+    // latest hop, so that a burst shorter than a hop still shows, and
+    // whether it is in alarm (see MonitorOptions).
+    size_t numberOfMonitoredBins = 0;
+    size_t monitoredBins[MAX_NUMBER_OF_MONITORED_BINS] = {};
+    float monitoredAmplitudes[MAX_NUMBER_OF_CHANNELS][MAX_NUMBER_OF_MONITORED_BINS] = {};
+    bool monitoredAlarms[MAX_NUMBER_OF_CHANNELS][MAX_NUMBER_OF_MONITORED_BINS] = {};
+
+    ScopeFrame scope;   // the latest samples, reduced for the scope views
+
+    void clearLevels(){
+        for (size_t channel=0; channel<MAX_NUMBER_OF_CHANNELS; channel++){
+            rmsDbfs[channel] = SILENCE_DBFS;
+            peakDbfs[channel] = SILENCE_DBFS;
+            truePeakDbfs[channel] = SILENCE_DBFS;
+        }
+    }
+};
+
+#endif
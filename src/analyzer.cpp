@@ -0,0 +1,306 @@
+#include "analyzer.hpp"
+#include "deinterleave.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+
+const double SCOPE_WAVEFORM_SECONDS = 0.1;
+const double SCOPE_PERSISTENCE_SECONDS = 0.2;
+
+const int WAIT_TIMEOUT_USECS = 100000;
+const int LAG_REPORT_PERIOD_SECONDS = 10;
+const float ALARM_HYSTERESIS_DB = 3.0f;   // below the alarm level, before it ends
+
+static_assert(Analyzer::STFT_FRAME_SIZE/2 + 1 <= SpectrogramRow::MAX_NUMBER_OF_BINS,
+              "a spectrogram row must hold every bin");
+
+
+Analyzer::Analyzer(SampleRing *sampleRing,
+                   AnalysisFeed *analysisFeed,
+                   SpectrogramFeed *spectrogramFeed,
+                   double sampleRate,
+                   const MonitorOptions &monitorOptions,
+                   function< void() > onNewFrame,
+                   function< void() > onEndOfStream) :
+    m_sampleRing(sampleRing),
+    m_analysisFeed(analysisFeed),
+    m_spectrogramFeed(spectrogramFeed),
+    m_spectrogramRow(),
+    m_sampleRate(sampleRate),
+    m_onNewFrame(onNewFrame),
+    m_onEndOfStream(onEndOfStream),
+    m_numberOfChannels(0),
+    m_stft(),
+    m_sequenceNumber(0),
+    m_scope(sampleRate, SCOPE_WAVEFORM_SECONDS, SCOPE_PERSISTENCE_SECONDS),
+    m_planar(),
+    m_planarPointers(),
+    m_wrappedFrame(),
+    m_levelMeters(),
+    m_monitoredBins(),
+    m_slidingDFTs(),
+    // a full scale sine gives STFT_FRAME_SIZE/2 in its bin
+    m_alarmAmplitude((float)(STFT_FRAME_SIZE/2) * powf(10.0f, monitorOptions.alarmDbfs / 20.0f)),
+    m_monitoredPeaks(),
+    m_monitoredAlarms(),
+    m_hopSumsOfSquares(),
+    m_hopPeaks(),
+    m_hopTruePeaks(),
+    m_hopIndex(0),
+    m_timestamp(),
+    m_lagSumMs(0.0),
+    m_lagMaxMs(0.0),
+    m_numberOfLagMeasures(0),
+    m_framesSinceLastReport(0)
+{
+    // the nearest bin of the spectra
+    for (double frequency : monitorOptions.frequencies){
+        if (m_monitoredBins.size() == AnalysisFrame::MAX_NUMBER_OF_MONITORED_BINS){
+            break;
+        }
+        const long bin = lround(frequency * STFT_FRAME_SIZE / sampleRate);
+        m_monitoredBins.push_back((size_t)max(0L, min(bin, (long)(STFT_FRAME_SIZE/2))));
+    }
+}
+
+size_t Analyzer::getNumberOfSpectrumBins(){
+    return STFT_FRAME_SIZE/2 + 1;
+}
+
+void Analyzer::analyzeForever(){
+    while ((m_numberOfChannels = m_sampleRing->getNumberOfChannels()) == 0){
+        if (m_sampleRing->isClosed()){
+            m_onEndOfStream();
+            return;
+        }
+        m_sampleRing->waitForData(WAIT_TIMEOUT_USECS);
+    }
+    m_stft.reset(new STFT(STFT_FRAME_SIZE, STFT_HOP_SIZE, STFT_WINDOW_TYPE, m_numberOfChannels));
+    m_hopSumsOfSquares.assign(STFT_FRAME_SIZE / STFT_HOP_SIZE * m_numberOfChannels, 0.0);
+    m_hopPeaks.assign(STFT_FRAME_SIZE / STFT_HOP_SIZE * m_numberOfChannels, 0.0f);
+    m_hopTruePeaks.assign(STFT_FRAME_SIZE / STFT_HOP_SIZE * m_numberOfChannels, 0.0f);
+    m_levelMeters.resize(m_numberOfChannels);
+    if (!m_monitoredBins.empty()){
+        m_slidingDFTs.assign(m_numberOfChannels, SlidingDFT(STFT_FRAME_SIZE, m_monitoredBins));
+        m_monitoredPeaks.assign(m_numberOfChannels * m_monitoredBins.size(), 0.0f);
+        m_monitoredAlarms.assign(m_numberOfChannels * m_monitoredBins.size(), false);
+    }
+    m_planar.assign(STFT_HOP_SIZE * m_numberOfChannels, 0.0f);
+    for (size_t channel=0; channel<m_numberOfChannels; channel++){
+        m_planarPointers.push_back(&m_planar[channel * STFT_HOP_SIZE]);
+    }
+    m_wrappedFrame.assign(m_numberOfChannels, 0.0f);
+
+    while (true){
+        m_sampleRing->waitForData(WAIT_TIMEOUT_USECS);
+        measureLag();
+        const bool closed = m_sampleRing->isClosed();
+
+        // the samples are analysed where they are in the ring
+        SampleSpan first, second;
+        size_t count;
+        while ((count = m_sampleRing->peek(first, second)) > 0){
+            const size_t sampleCount = m_sampleRing->getReadCount();
+
+            // a frame cut by the end of the ring is put back together aside
+            const size_t cutSamples = first.count % m_numberOfChannels;
+            const size_t wholeSamples = first.count - cutSamples;
+            analyzeSpan(SampleSpan{ first.samples, wholeSamples }, sampleCount);
+            size_t secondOffset = 0;
+            if (cutSamples > 0){
+                secondOffset = m_numberOfChannels - cutSamples;
+                copy(first.samples + wholeSamples, first.samples + first.count, m_wrappedFrame.begin());
+                copy(second.samples, second.samples + secondOffset, m_wrappedFrame.begin() + cutSamples);
+                analyzeSpan(SampleSpan{ m_wrappedFrame.data(), m_numberOfChannels }, sampleCount + wholeSamples);
+            }
+            analyzeSpan(SampleSpan{ second.samples + secondOffset, second.count - secondOffset },
+                        sampleCount + first.count + secondOffset);
+            m_sampleRing->release(count);
+            m_framesSinceLastReport += count / m_numberOfChannels;
+        }
+
+        if (m_framesSinceLastReport >= LAG_REPORT_PERIOD_SECONDS * m_sampleRate){
+            reportLag();
+            reportLosses();
+        }
+        if (closed){
+            m_onEndOfStream();
+            return;
+        }
+    }
+}
+
+// sampleCount : position of the first sample of the span in the stream
+void Analyzer::analyzeSpan(const SampleSpan &span, size_t sampleCount){
+    const size_t numberOfFrames = span.count / m_numberOfChannels;
+    size_t frame = 0;
+    while (frame < numberOfFrames){
+        // the blocks end at the hops, where the frames are published
+        const size_t blockFrames = min(numberOfFrames - frame, m_stft->getFramesUntilHop());
+        const float *block = &span.samples[frame * m_numberOfChannels];
+        deinterleave(block, blockFrames, m_numberOfChannels, m_planarPointers.data());
+
+        double *sumsOfSquares = &m_hopSumsOfSquares[m_hopIndex * m_numberOfChannels];
+        float *peaks = &m_hopPeaks[m_hopIndex * m_numberOfChannels];
+        float *truePeaks = &m_hopTruePeaks[m_hopIndex * m_numberOfChannels];
+        for (size_t channel=0; channel<m_numberOfChannels; channel++){
+            const LevelMeasures measures = m_levelMeters[channel].measure(m_planarPointers[channel], blockFrames);
+            sumsOfSquares[channel] += measures.sumOfSquares;
+            peaks[channel] = max(peaks[channel], measures.peak);
+            truePeaks[channel] = max(truePeaks[channel], measures.truePeak);
+            if (!m_slidingDFTs.empty()){
+                m_slidingDFTs[channel].addSamples(m_planarPointers[channel], blockFrames);
+                checkMonitoredBins(channel);
+            }
+        }
+
+        for (size_t i=0; i<blockFrames; i++){
+            m_scope.addFrame(&block[i * m_numberOfChannels], m_numberOfChannels);
+        }
+        frame += blockFrames;
+        if (m_stft->addFrames(m_planarPointers.data(), blockFrames)){
+            publishFrame(sampleCount + (frame - 1) * m_numberOfChannels);
+        }
+    }
+}
+
+// Right after each block: an alarm is reported as soon as the samples that
+// raise it are analysed.
+void Analyzer::checkMonitoredBins(size_t channel){
+    static const float releaseRatio = powf(10.0f, -ALARM_HYSTERESIS_DB / 20.0f);
+    const vector< float > &amplitudes = m_slidingDFTs[channel].computePeakAmplitudes();
+    for (size_t bin=0; bin<amplitudes.size(); bin++){
+        const size_t index = channel * m_monitoredBins.size() + bin;
+        m_monitoredPeaks[index] = max(m_monitoredPeaks[index], amplitudes[bin]);
+        if (!m_monitoredAlarms[index] && amplitudes[bin] >= m_alarmAmplitude){
+            m_monitoredAlarms[index] = true;
+            cout << "Alarm : " << (double)m_monitoredBins[bin] * m_sampleRate / STFT_FRAME_SIZE << " Hz at "
+                 << toDbfs(amplitudes[bin] / (STFT_FRAME_SIZE/2)) << " dBFS on channel " << channel << endl;
+        } else if (m_monitoredAlarms[index] && amplitudes[bin] < m_alarmAmplitude * releaseRatio){
+            m_monitoredAlarms[index] = false;
+        }
+    }
+}
+
+// sampleCount : position in the stream of the latest samples given to the STFT
+void Analyzer::publishFrame(size_t sampleCount){
+    AnalysisFrame &analysisFrame = m_analysisFeed->getBack();
+    const size_t numberOfHops = m_hopPeaks.size() / m_numberOfChannels;
+
+    analysisFrame.sequenceNumber = m_sequenceNumber++;
+
+    SampleTimestamp *timestamp;
+    while ((timestamp = m_sampleRing->peekTimestamp()) && timestamp->sampleCount <= sampleCount){
+        m_timestamp = *timestamp;
+        m_sampleRing->popTimestamp();
+    }
+    const double secondsSinceTimestamp = (double)((sampleCount - m_timestamp.sampleCount) / m_numberOfChannels) / m_sampleRate;
+    analysisFrame.adcTime = m_timestamp.adcTime + secondsSinceTimestamp;
+    analysisFrame.captureTime = m_timestamp.captureTime
+        + chrono::duration_cast< chrono::steady_clock::duration >(chrono::duration< double >(secondsSinceTimestamp));
+
+    analysisFrame.numberOfChannels = m_numberOfChannels;
+    for (size_t channel=0; channel<m_numberOfChannels; channel++){
+        double sumOfSquares = 0.0;
+        float peak = 0.0f;
+        float truePeak = 0.0f;
+        for (size_t hop=0; hop<numberOfHops; hop++){
+            sumOfSquares += m_hopSumsOfSquares[hop * m_numberOfChannels + channel];
+            peak = max(peak, m_hopPeaks[hop * m_numberOfChannels + channel]);
+            truePeak = max(truePeak, m_hopTruePeaks[hop * m_numberOfChannels + channel]);
+        }
+        analysisFrame.rmsDbfs[channel] = toDbfs(sqrt(sumOfSquares / STFT_FRAME_SIZE));
+        analysisFrame.peakDbfs[channel] = toDbfs(peak);
+        analysisFrame.truePeakDbfs[channel] = toDbfs(truePeak);
+    }
+
+    analysisFrame.numberOfMonitoredBins = m_monitoredBins.size();
+    copy(m_monitoredBins.begin(), m_monitoredBins.end(), analysisFrame.monitoredBins);
+    for (size_t channel=0; channel<m_slidingDFTs.size(); channel++){
+        for (size_t bin=0; bin<m_monitoredBins.size(); bin++){
+            const size_t index = channel * m_monitoredBins.size() + bin;
+            analysisFrame.monitoredAmplitudes[channel][bin] = m_monitoredPeaks[index];
+            analysisFrame.monitoredAlarms[channel][bin] = m_monitoredAlarms[index];
+            m_monitoredPeaks[index] = 0.0f;
+        }
+    }
+
+    m_stft->computeSpectra(analysisFrame.spectra);
+    publishSpectrogramRow(analysisFrame.spectra);
+    m_scope.fill(analysisFrame.scope);
+    m_analysisFeed->publish();
+    m_onNewFrame();
+
+    // the oldest hop leaves the frame, the next one starts from zero
+    m_hopIndex = (m_hopIndex + 1) % numberOfHops;
+    for (size_t channel=0; channel<m_numberOfChannels; channel++){
+        m_hopSumsOfSquares[m_hopIndex * m_numberOfChannels + channel] = 0.0;
+        m_hopPeaks[m_hopIndex * m_numberOfChannels + channel] = 0.0f;
+        m_hopTruePeaks[m_hopIndex * m_numberOfChannels + channel] = 0.0f;
+    }
+}
+
+// When the display is stalled and the queue full, the newest rows are lost.
+void Analyzer::publishSpectrogramRow(const SpectrumFrame &spectra){
+    const size_t numberOfBins = STFT_FRAME_SIZE/2 + 1;
+    const float fullScale = (float)(STFT_FRAME_SIZE/2);   // bin amplitude of a full scale sine
+    const int lastStep = -SpectrogramRow::FLOOR_DB;
+
+    m_spectrogramRow.numberOfBins = numberOfBins;
+    for (size_t k=0; k<numberOfBins; k++){
+        // the mean power of the channels
+        float amplitude = spectra.channels[0][k];
+        if (m_numberOfChannels > 1){
+            float sumOfSquares = 0.0f;
+            for (size_t channel=0; channel<m_numberOfChannels; channel++){
+                sumOfSquares += spectra.channels[channel][k] * spectra.channels[channel][k];
+            }
+            amplitude = sqrtf(sumOfSquares / m_numberOfChannels);
+        }
+        int step = 0;
+        if (amplitude > 0.0f){
+            step = (int)(20.0f * log10f(amplitude / fullScale)) - SpectrogramRow::FLOOR_DB;
+            step = max(0, min(step, lastStep));
+        }
+        m_spectrogramRow.steps[k] = (uint8_t)step;
+    }
+    m_spectrogramFeed->try_enqueue(m_spectrogramRow);
+}
+
+void Analyzer::measureLag(){
+    const double lagMs = (double)(m_sampleRing->available() / m_numberOfChannels) * 1000.0 / m_sampleRate;
+    m_lagSumMs += lagMs;
+    m_lagMaxMs = max(m_lagMaxMs, lagMs);
+    m_numberOfLagMeasures++;
+}
+
+void Analyzer::reportLag(){
+    cout << "Analysis lag : " << (m_lagSumMs / m_numberOfLagMeasures) << " ms on average, "
+         << m_lagMaxMs << " ms at most" << endl;
+    m_lagSumMs = 0.0;
+    m_lagMaxMs = 0.0;
+    m_numberOfLagMeasures = 0;
+    m_framesSinceLastReport = 0;
+}
+
+void Analyzer::reportLosses(){
+    const SampleRingStatistics statistics = m_sampleRing->getStatistics();
+    if (statistics.inputOverflows || statistics.inputUnderflows || statistics.ringFullEvents){
+        cout << "Input overflows : " << statistics.inputOverflows
+             << ", input underflows : " << statistics.inputUnderflows
+             << ", ring full : " << statistics.ringFullEvents
+             << " times, " << statistics.droppedFrames << " frames dropped" << endl;
+    }
+#ifdef VUMETER_QUEUE_STATS
+    const QueueStatistics queueStatistics = m_sampleRing->getTimestampQueueStatistics();
+    cout << "Timestamp queue : " << queueStatistics.enqueued << " enqueued, "
+         << queueStatistics.failedEnqueues << " refused, peak depth " << queueStatistics.peakDepth
+         << ", latency " << queueStatistics.averageLatencyUs << " us on average, "
+         << queueStatistics.maxLatencyUs << " us at most" << endl;
+#endif
+}
@@ -0,0 +1,117 @@
+#ifndef ANALYZER_HPP
+#define ANALYZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include "rwqueuetype.hpp"
+#include "samplering.hpp"
+#include "stft.hpp"
+#include "scope.hpp"
+#include "levelmeter.hpp"
+#include "slidingdft.hpp"
+
+
+// The bins the Analyzer follows sample by sample through a SlidingDFT, and
+// the level above which it raises an alarm on them.
+struct MonitorOptions {
+    std::vector< double > frequencies;   // in Hz, each one for the nearest bin of the spectra
+    float alarmDbfs = -20.0f;            // the bin of a sine at that level
+};
+
+
+// Level metering and spectrum analysis, on a thread of their own so that
+// the PortAudio callback only has to copy the raw samples into the ring.
+// The analysis runs at its own pace: when it falls behind, the samples wait
+// in the ring. The lag, and whatever was lost on the way from the sound
+// card, are reported periodically on the standard output.
+// The samples are split into one buffer per channel, a block at a time up
+// to the end of the current hop, and every channel is metered and
+// transformed on its own, whatever their number. The levels are published
+// in dBFS, the true peak included. A few monitored bins are also followed
+// sample by sample through a SlidingDFT: each block is checked against the
+// alarm level as soon as it is analysed, without waiting for the hop, and
+// an alarm is reported on the standard output when it starts.
+// Every hop of the STFT produces one AnalysisFrame: the spectra of the
+// latest frame, the levels of the same samples, the latest samples reduced
+// for the scope views, and the time at which the last of them was captured.
+// The display may only read the newest of them, so every hop also queues
+// its row of the spectrogram.
+class Analyzer {
+public:
+    explicit Analyzer(SampleRing *sampleRing,
+                      AnalysisFeed *analysisFeed,
+                      SpectrogramFeed *spectrogramFeed,
+                      double sampleRate,
+                      const MonitorOptions &monitorOptions,
+                      std::function< void() > onNewFrame,
+                      std::function< void() > onEndOfStream);
+
+    // Never returns for a live input. Once the ring is closed and every
+    // sample in it analysed, calls onEndOfStream and returns.
+    void analyzeForever();
+
+    // The parameters of the analysis, shared with the BatchAnalyzer.
+    // 75% overlap : a frame every 128 samples / 16000 Hz = 8 ms, faster
+    // than the display refreshes.
+    static const size_t STFT_FRAME_SIZE = (1 << 9);
+    static const size_t STFT_HOP_SIZE = STFT_FRAME_SIZE / 4;
+    static const WindowType STFT_WINDOW_TYPE = WindowType::hann;
+
+    static size_t getNumberOfSpectrumBins();
+private:
+    SampleRing *m_sampleRing;
+    AnalysisFeed *m_analysisFeed;
+    SpectrogramFeed *m_spectrogramFeed;
+    SpectrogramRow m_spectrogramRow;
+    double m_sampleRate;
+    std::function< void() > m_onNewFrame;   // called after each published frame
+    std::function< void() > m_onEndOfStream;
+    size_t m_numberOfChannels;
+    std::unique_ptr< STFT > m_stft;   // created once the number of channels is known
+    uint64_t m_sequenceNumber;
+    Scope m_scope;
+
+    // the samples of the current block, one buffer per channel, and the
+    // frame cut by the end of the ring put back together
+    std::vector< float > m_planar;
+    std::vector< float * > m_planarPointers;
+    std::vector< float > m_wrappedFrame;
+
+    // sum of squares, peak and true peak of each channel, for each hop of
+    // the current frame, the current hop at m_hopIndex
+    std::vector< LevelMeter > m_levelMeters;
+    // the largest amplitude of each monitored bin of each channel during the
+    // current hop, and whether it is in alarm
+    std::vector< size_t > m_monitoredBins;
+    std::vector< SlidingDFT > m_slidingDFTs;   // one per channel, when bins are monitored
+    float m_alarmAmplitude;
+    std::vector< float > m_monitoredPeaks;
+    std::vector< bool > m_monitoredAlarms;
+    std::vector< double > m_hopSumsOfSquares;
+    std::vector< float > m_hopPeaks;
+    std::vector< float > m_hopTruePeaks;
+    size_t m_hopIndex;
+
+    // the latest timestamp of the ring, to date the samples after it
+    SampleTimestamp m_timestamp;
+
+    // samples waiting in the ring each time the thread wakes up
+    double m_lagSumMs;
+    double m_lagMaxMs;
+    size_t m_numberOfLagMeasures;
+    size_t m_framesSinceLastReport;
+
+    void measureLag();
+    void analyzeSpan(const SampleSpan &span, size_t sampleCount);
+    void checkMonitoredBins(size_t channel);
+    void publishFrame(size_t sampleCount);
+    void publishSpectrogramRow(const SpectrumFrame &spectra);
+    void reportLosses();
+    void reportLag();
+};
+
+#endif
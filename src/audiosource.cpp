@@ -0,0 +1,51 @@
+#include "audiosource.hpp"
+
+#include <vector>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+
+// The same as the PortAudio callbacks: 512 frames, 32 ms at 16000 Hz.
+const size_t FRAMES_PER_BLOCK = (1 << 9);
+const int FULL_RING_SLEEP_USECS = 500;
+
+
+BlockAudioSource::BlockAudioSource(Pacing pacing) :
+    m_pacing(pacing)
+{
+}
+
+void BlockAudioSource::run(SampleRing *sampleRing){
+    const size_t numberOfChannels = getNumberOfChannels();
+    const double sampleRate = getSampleRate();
+    sampleRing->setNumberOfChannels(numberOfChannels);
+
+    vector< float > block(FRAMES_PER_BLOCK * numberOfChannels);
+    const steady_clock::time_point start = steady_clock::now();
+    uint64_t framesWritten = 0;
+    size_t numberOfFrames;
+
+    while ((numberOfFrames = readFrames(block.data(), FRAMES_PER_BLOCK)) > 0){
+        const size_t count = numberOfFrames * numberOfChannels;
+        const double adcTime = (double)framesWritten / sampleRate;
+        steady_clock::time_point captureTime;
+
+        if (m_pacing == Pacing::realTime){
+            // a sound card delivers a block once its last sample is captured
+            const double endTime = (double)(framesWritten + numberOfFrames) / sampleRate;
+            this_thread::sleep_until(start + duration_cast< steady_clock::duration >(duration< double >(endTime)));
+            captureTime = start + duration_cast< steady_clock::duration >(duration< double >(adcTime));
+        } else {
+            while (sampleRing->getFreeSpace() < count){
+                this_thread::sleep_for(microseconds(FULL_RING_SLEEP_USECS));
+            }
+            captureTime = steady_clock::now();
+        }
+
+        sampleRing->write(block.data(), count, adcTime, captureTime);
+        framesWritten += numberOfFrames;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef AUDIO_SOURCE_HPP
+#define AUDIO_SOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "samplering.hpp"
+
+
+// Where the samples come from: the sound card, a file, a generator. The
+// source writes interleaved float samples, dated, into the ring from the
+// thread that calls run, and sets the number of channels of the ring
+// before its first write.
+class AudioSource {
+public:
+    virtual ~AudioSource() {}
+    virtual double getSampleRate() const = 0;
+
+    // Returns when the source is exhausted, never for a live input.
+    virtual void run(SampleRing *sampleRing) = 0;
+};
+
+
+enum class Pacing {
+    realTime,           // one block at the time a sound card would deliver it
+    asFastAsPossible    // as fast as the analysis takes them, nothing dropped
+};
+
+// A source that produces its samples on demand, block by block, at the
+// pace it is asked for. In real time, the blocks are dated as if they had
+// been captured by a sound card started with run, and the ring may drop
+// what the analysis cannot keep up with, just as with a live input. As
+// fast as possible, the source waits for room in the ring instead, and
+// the blocks are dated when they are written.
+class BlockAudioSource : public AudioSource {
+public:
+    void run(SampleRing *sampleRing) override;
+
+protected:
+    explicit BlockAudioSource(Pacing pacing);
+
+    virtual size_t getNumberOfChannels() const = 0;
+
+    // Writes up to numberOfFrames frames into samples and returns how many,
+    // 0 once the source is exhausted.
+    virtual size_t readFrames(float *samples, size_t numberOfFrames) = 0;
+
+private:
+    Pacing m_pacing;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "batchanalyzer.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdlib>
+
+
+void printUsage(const char *program){
+    std::cout << "Usage: " << program << " [options] FILE.wav..." << std::endl
+              << "Writes the levels and spectra of every frame of each file to FILE.wav.vuframes" << std::endl
+              << "  --threads N         analyse on N threads (all the cores by default)" << std::endl
+              << "  --output DIR        write the results to DIR instead of next to the files" << std::endl;
+}
+
+int main(int argc, char *argv[]){
+    size_t numberOfThreads = std::thread::hardware_concurrency();
+    std::string outputDirectory;
+    std::vector< std::string > fileNames;
+
+    for (int i=1; i<argc; i++){
+        const std::string argument = argv[i];
+        const bool hasValue = (i+1 < argc);
+        if (argument == "--threads" && hasValue){
+            numberOfThreads = std::strtoul(argv[++i], NULL, 10);
+        } else if (argument == "--output" && hasValue){
+            outputDirectory = argv[++i];
+        } else if (argument.compare(0, 2, "--") == 0){
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            fileNames.push_back(argument);
+        }
+    }
+    if (fileNames.empty()){
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    return BatchAnalyzer(fileNames, outputDirectory, numberOfThreads).run() ? 0 : 1;
+}
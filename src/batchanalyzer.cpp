@@ -0,0 +1,311 @@
+#include "batchanalyzer.hpp"
+#include "analyzer.hpp"
+#include "stft.hpp"
+#include "levelmeter.hpp"
+#include "deinterleave.hpp"
+#include "workstealingpool.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+const size_t FRAME_SIZE = Analyzer::STFT_FRAME_SIZE;
+const size_t HOP_SIZE = Analyzer::STFT_HOP_SIZE;
+const size_t HOPS_PER_FRAME = FRAME_SIZE / HOP_SIZE;
+
+// Long enough for the warm up of each chunk to be negligible, short
+// enough for a few files to keep every core busy.
+const double CHUNK_SECONDS = 30.0;
+
+const uint32_t OUTPUT_VERSION = 2;
+const size_t HEADER_BYTES = 4 + 6*4 + 8;
+const size_t LEVEL_BYTES = 3*2;   // RMS, peak and true peak of a channel
+
+
+static void writeUint16(uint8_t *&output, uint16_t value){
+    *output++ = (uint8_t)value;
+    *output++ = (uint8_t)(value >> 8);
+}
+
+static void writeUint32(uint8_t *&output, uint32_t value){
+    writeUint16(output, (uint16_t)value);
+    writeUint16(output, (uint16_t)(value >> 16));
+}
+
+// In 1/100 dB, silence at the lowest value.
+static int16_t toCentiDecibels(double amplitude){
+    if (amplitude <= 0.0){
+        return INT16_MIN;
+    }
+    return (int16_t)max(-32768.0, min(32767.0, round(2000.0 * log10(amplitude))));
+}
+
+static bool writeAll(int fileDescriptor, const uint8_t *bytes, size_t size, off_t offset){
+    while (size > 0){
+        const ssize_t written = pwrite(fileDescriptor, bytes, size, offset);
+        if (written < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= (size_t)written;
+        offset += written;
+    }
+    return true;
+}
+
+
+BatchAnalyzer::BatchAnalyzer(const vector< string > &fileNames,
+                             const string &outputDirectory,
+                             size_t numberOfThreads) :
+    m_numberOfThreads(max((size_t)1, numberOfThreads)),
+    m_files(),
+    m_chunks(),
+    m_numberOfSkippedFiles(0),
+    m_writeFailed(false)
+{
+    openFiles(fileNames, outputDirectory);
+}
+
+BatchAnalyzer::~BatchAnalyzer(){
+    for (AnalyzedFile &file : m_files){
+        if (file.outputDescriptor >= 0){
+            close(file.outputDescriptor);
+        }
+    }
+}
+
+// The files which cannot be read, or whose output cannot be created, are
+// reported and left out.
+void BatchAnalyzer::openFiles(const vector< string > &fileNames, const string &outputDirectory){
+    m_files.reserve(fileNames.size());
+    for (const string &fileName : fileNames){
+        AnalyzedFile file;
+        file.fileName = fileName;
+        file.outputDescriptor = -1;
+        try {
+            file.wavFile.reset(new WavFile(fileName));
+        } catch (const WavFile::CannotOpenFileException &) {
+            m_numberOfSkippedFiles++;
+            continue;
+        } catch (const WavFile::UnsupportedFormatException &) {
+            m_numberOfSkippedFiles++;
+            continue;
+        }
+
+        const size_t slash = fileName.find_last_of('/');
+        const string baseName = (slash == string::npos) ? fileName : fileName.substr(slash + 1);
+        file.outputFileName = (outputDirectory.empty() ? fileName : outputDirectory + "/" + baseName) + ".vuframes";
+
+        const size_t numberOfChannels = file.wavFile->getNumberOfChannels();
+        file.numberOfFrames = file.wavFile->getNumberOfFrames() / HOP_SIZE;
+        file.frameBytes = numberOfChannels * (LEVEL_BYTES + FRAME_SIZE/2 + 1);
+        try {
+            createOutput(file);
+        } catch (const CannotWriteFileException &) {
+            if (file.outputDescriptor >= 0){
+                close(file.outputDescriptor);
+                unlink(file.outputFileName.c_str());
+            }
+            m_numberOfSkippedFiles++;
+            continue;
+        }
+
+        const size_t chunkSize = max((size_t)1, (size_t)(CHUNK_SECONDS * file.wavFile->getSampleRate()) / HOP_SIZE) * HOP_SIZE;
+        const size_t endSample = file.numberOfFrames * HOP_SIZE;
+        for (size_t firstSample=0; firstSample<endSample; firstSample+=chunkSize){
+            m_chunks.push_back(Chunk{ m_files.size(), firstSample, min(endSample, firstSample + chunkSize) });
+        }
+        m_files.push_back(move(file));
+    }
+}
+
+// The output is sized and its header written up front, the chunks fill
+// in the frames.
+void BatchAnalyzer::createOutput(AnalyzedFile &file){
+    file.outputDescriptor = open(file.outputFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    const off_t outputSize = (off_t)(HEADER_BYTES + file.numberOfFrames * file.frameBytes);
+    if (file.outputDescriptor < 0 || ftruncate(file.outputDescriptor, outputSize) != 0){
+        cout << "Unable to create " << file.outputFileName << ": " << strerror(errno) << endl;
+        throw CannotWriteFileException();
+    }
+
+    uint8_t header[HEADER_BYTES];
+    uint8_t *output = header;
+    memcpy(output, "VUFR", 4);
+    output += 4;
+    writeUint32(output, OUTPUT_VERSION);
+    writeUint32(output, (uint32_t)file.wavFile->getNumberOfChannels());
+    writeUint32(output, (uint32_t)lround(file.wavFile->getSampleRate()));
+    writeUint32(output, (uint32_t)FRAME_SIZE);
+    writeUint32(output, (uint32_t)HOP_SIZE);
+    writeUint32(output, (uint32_t)(FRAME_SIZE/2 + 1));
+    writeUint32(output, (uint32_t)file.numberOfFrames);
+    writeUint32(output, (uint32_t)((uint64_t)file.numberOfFrames >> 32));
+    if (!writeAll(file.outputDescriptor, header, HEADER_BYTES, 0)){
+        cout << "Unable to write " << file.outputFileName << ": " << strerror(errno) << endl;
+        throw CannotWriteFileException();
+    }
+}
+
+bool BatchAnalyzer::run(){
+    double audioSeconds = 0.0;
+    for (const AnalyzedFile &file : m_files){
+        audioSeconds += (double)(file.numberOfFrames * HOP_SIZE) / file.wavFile->getSampleRate();
+    }
+    cout << "Analysing " << audioSeconds << " s of audio in " << m_files.size() << " files, "
+         << m_chunks.size() << " chunks, on " << m_numberOfThreads << " threads" << endl;
+
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    WorkStealingPool pool(m_numberOfThreads, true);
+    // the buffers of each worker, reused from one chunk to the next
+    vector< vector< float > > samples(pool.getNumberOfWorkers());
+    vector< vector< uint8_t > > outputs(pool.getNumberOfWorkers());
+    for (const Chunk &chunk : m_chunks){
+        pool.submit([this, &pool, &samples, &outputs, &chunk](){
+                        const size_t worker = pool.getCurrentWorker();
+                        analyzeChunk(chunk, samples[worker], outputs[worker]);
+                    },
+                    chunk.fileIndex);
+    }
+    pool.waitForAll();
+    const double elapsedSeconds = chrono::duration< double >(chrono::steady_clock::now() - start).count();
+    const WorkStealingStatistics statistics = pool.getStatistics();
+
+    for (const AnalyzedFile &file : m_files){
+        cout << file.outputFileName << ": " << file.numberOfFrames << " frames" << endl;
+    }
+    if (m_writeFailed.load()){
+        cout << "Some frames could not be written" << endl;
+    }
+    if (m_numberOfSkippedFiles > 0){
+        cout << m_numberOfSkippedFiles << " files left out" << endl;
+    }
+    cout << "Analysed " << audioSeconds << " s of audio in " << elapsedSeconds << " s: "
+         << (audioSeconds / elapsedSeconds) << " times realtime, "
+         << statistics.stolenTasks << " of " << statistics.executedTasks << " chunks stolen" << endl;
+    return m_numberOfSkippedFiles == 0 && !m_writeFailed.load();
+}
+
+// The same computation as Analyzer::analyzeSpan and Analyzer::publishFrame:
+// blocks up to the end of each hop, deinterleaved, metered channel by
+// channel and given to the STFT.
+void BatchAnalyzer::analyzeChunk(const Chunk &chunk, vector< float > &samples, vector< uint8_t > &output){
+    const AnalyzedFile &file = m_files[chunk.fileIndex];
+    const size_t numberOfChannels = file.wavFile->getNumberOfChannels();
+    // the first frame needs the samples of the previous hops, and the true
+    // peak filters a few more before them
+    const size_t warmUp = min(chunk.firstSample, FRAME_SIZE - HOP_SIZE);
+    const size_t filterWarmUp = min(chunk.firstSample - warmUp, (size_t)LevelMeter::TAPS_PER_PHASE);
+    const size_t firstSample = chunk.firstSample - warmUp - filterWarmUp;
+    const size_t numberOfSamples = chunk.endSample - firstSample;
+
+    samples.resize(numberOfSamples * numberOfChannels);
+    file.wavFile->readFrames(firstSample, samples.data(), numberOfSamples);
+    output.resize((chunk.endSample - chunk.firstSample) / HOP_SIZE * file.frameBytes);
+
+    STFT stft(FRAME_SIZE, HOP_SIZE, Analyzer::STFT_WINDOW_TYPE, numberOfChannels);
+    SpectrumFrame spectra(stft.numberOfBins(), numberOfChannels);
+    spectra.numberOfChannels = numberOfChannels;
+    vector< LevelMeter > levelMeters(numberOfChannels);
+    vector< float > planar(HOP_SIZE * numberOfChannels);
+    vector< float * > planarPointers(numberOfChannels);
+    for (size_t channel=0; channel<numberOfChannels; channel++){
+        planarPointers[channel] = &planar[channel * HOP_SIZE];
+    }
+    vector< double > hopSumsOfSquares(HOPS_PER_FRAME * numberOfChannels, 0.0);
+    vector< float > hopPeaks(HOPS_PER_FRAME * numberOfChannels, 0.0f);
+    vector< float > hopTruePeaks(HOPS_PER_FRAME * numberOfChannels, 0.0f);
+    vector< double > sumsOfSquares(numberOfChannels);
+    vector< float > peaks(numberOfChannels);
+    vector< float > truePeaks(numberOfChannels);
+    size_t hopIndex = 0;
+    uint8_t *frameOutput = output.data();
+
+    // the filters get the history they have when the file is analysed in
+    // one go, nothing is measured
+    deinterleave(samples.data(), filterWarmUp, numberOfChannels, planarPointers.data());
+    for (size_t channel=0; channel<numberOfChannels; channel++){
+        levelMeters[channel].measure(planarPointers[channel], filterWarmUp);
+    }
+
+    size_t frame = filterWarmUp;
+    while (frame < numberOfSamples){
+        const size_t blockFrames = min(numberOfSamples - frame, stft.getFramesUntilHop());
+        deinterleave(&samples[frame * numberOfChannels], blockFrames, numberOfChannels, planarPointers.data());
+        for (size_t channel=0; channel<numberOfChannels; channel++){
+            const LevelMeasures measures = levelMeters[channel].measure(planarPointers[channel], blockFrames);
+            const size_t index = hopIndex * numberOfChannels + channel;
+            hopSumsOfSquares[index] += measures.sumOfSquares;
+            hopPeaks[index] = max(hopPeaks[index], measures.peak);
+            hopTruePeaks[index] = max(hopTruePeaks[index], measures.truePeak);
+        }
+        frame += blockFrames;
+        if (!stft.addFrames(planarPointers.data(), blockFrames)){
+            continue;
+        }
+
+        // the frames of the warm up belong to the previous chunk
+        if (firstSample + frame - 1 >= chunk.firstSample){
+            for (size_t channel=0; channel<numberOfChannels; channel++){
+                sumsOfSquares[channel] = 0.0;
+                peaks[channel] = 0.0f;
+                truePeaks[channel] = 0.0f;
+                for (size_t hop=0; hop<HOPS_PER_FRAME; hop++){
+                    sumsOfSquares[channel] += hopSumsOfSquares[hop * numberOfChannels + channel];
+                    peaks[channel] = max(peaks[channel], hopPeaks[hop * numberOfChannels + channel]);
+                    truePeaks[channel] = max(truePeaks[channel], hopTruePeaks[hop * numberOfChannels + channel]);
+                }
+            }
+            stft.computeSpectra(spectra);
+            encodeFrame(file, sumsOfSquares.data(), peaks.data(), truePeaks.data(), spectra, frameOutput);
+            frameOutput += file.frameBytes;
+        }
+
+        hopIndex = (hopIndex + 1) % HOPS_PER_FRAME;
+        for (size_t channel=0; channel<numberOfChannels; channel++){
+            hopSumsOfSquares[hopIndex * numberOfChannels + channel] = 0.0;
+            hopPeaks[hopIndex * numberOfChannels + channel] = 0.0f;
+            hopTruePeaks[hopIndex * numberOfChannels + channel] = 0.0f;
+        }
+    }
+
+    const off_t offset = (off_t)(HEADER_BYTES + chunk.firstSample / HOP_SIZE * file.frameBytes);
+    if (!writeAll(file.outputDescriptor, output.data(), output.size(), offset)){
+        m_writeFailed.store(true);
+    }
+}
+
+void BatchAnalyzer::encodeFrame(const AnalyzedFile &file, const double *sumsOfSquares, const float *peaks,
+                                const float *truePeaks, const SpectrumFrame &spectra, uint8_t *output){
+    const size_t numberOfChannels = file.wavFile->getNumberOfChannels();
+    for (size_t channel=0; channel<numberOfChannels; channel++){
+        writeUint16(output, (uint16_t)toCentiDecibels(sqrt(sumsOfSquares[channel] / FRAME_SIZE)));
+        writeUint16(output, (uint16_t)toCentiDecibels(peaks[channel]));
+        writeUint16(output, (uint16_t)toCentiDecibels(truePeaks[channel]));
+    }
+
+    // a full scale sine gives FRAME_SIZE/2 in its bin
+    const float fullScale = (float)(FRAME_SIZE / 2);
+    for (size_t channel=0; channel<numberOfChannels; channel++){
+        const vector< float > &amplitudes = spectra.channels[channel];
+        for (size_t k=0; k<amplitudes.size(); k++){
+            int step = 0;
+            if (amplitudes[k] > 0.0f){
+                step = 255 + (int)lround(40.0f * log10f(amplitudes[k] / fullScale));
+                step = max(0, min(255, step));
+            }
+            *output++ = (uint8_t)step;
+        }
+    }
+}
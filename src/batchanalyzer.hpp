@@ -0,0 +1,79 @@
+#ifndef BATCH_ANALYZER_HPP
+#define BATCH_ANALYZER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <cstddef>
+#include <cstdint>
+
+#include "wavfile.hpp"
+#include "spectrumframe.hpp"
+
+
+// Offline version of the Analyzer: the same levels and spectra, frame by
+// frame, over whole WAV files and as fast as the machine goes. The hops go
+// through the same LevelMeter, deinterleave and STFT as the live analysis.
+// Every file is cut into chunks of whole hops, each one a task of a
+// WorkStealingPool: the chunks of a file go to the same worker, pinned to
+// its core, and the idle workers steal from the busy ones. A chunk starts
+// frameSize - hopSize samples early, plus the history of the true peak
+// filter, so that its first frame sees the same samples as when the file
+// is analysed in one go: the result does not depend on the chunking.
+// Each chunk writes its frames at their place in the output file, so the
+// threads never wait for each other.
+//
+// Output, FILE.wav.vuframes next to the input or in the output directory,
+// little endian:
+//   header : "VUFR", then uint32 version, numberOfChannels, sampleRate,
+//            frameSize, hopSize, numberOfBins, and uint64 numberOfFrames
+//   frames : for each channel int16 RMS, int16 peak and int16 true peak in
+//            1/100 dBFS, then for each channel numberOfBins uint8, the
+//            amplitude of the bin in half dB steps from -127.5 dBFS (0)
+//            to 0 dBFS (255)
+class BatchAnalyzer {
+public:
+    explicit BatchAnalyzer(const std::vector< std::string > &fileNames,
+                           const std::string &outputDirectory,   // empty : next to the inputs
+                           size_t numberOfThreads);
+    ~BatchAnalyzer();
+
+    // Analyses every file that could be opened, and reports the throughput.
+    // Returns false when a file was left out or a frame could not be written.
+    bool run();
+
+    class CannotWriteFileException : std::exception {};
+
+private:
+    struct AnalyzedFile {
+        std::string fileName;
+        std::unique_ptr< WavFile > wavFile;
+        std::string outputFileName;
+        int outputDescriptor;
+        size_t numberOfFrames;   // analysis frames, one per complete hop
+        size_t frameBytes;
+    };
+
+    // The samples [firstSample, endSample) of a file, in whole hops.
+    struct Chunk {
+        size_t fileIndex;
+        size_t firstSample;
+        size_t endSample;
+    };
+
+    size_t m_numberOfThreads;
+    std::vector< AnalyzedFile > m_files;
+    std::vector< Chunk > m_chunks;
+    size_t m_numberOfSkippedFiles;
+    std::atomic< bool > m_writeFailed;
+
+    void openFiles(const std::vector< std::string > &fileNames, const std::string &outputDirectory);
+    void createOutput(AnalyzedFile &file);
+    void analyzeChunk(const Chunk &chunk, std::vector< float > &samples, std::vector< uint8_t > &output);
+    void encodeFrame(const AnalyzedFile &file, const double *sumsOfSquares, const float *peaks,
+                     const float *truePeaks, const SpectrumFrame &spectra, uint8_t *output);
+};
+
+#endif
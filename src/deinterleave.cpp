@@ -0,0 +1,103 @@
+#include "deinterleave.hpp"
+
+#include <algorithm>
+
+// SSE2 is part of x86-64, and NEON has to be enabled at compile time on
+// 32 bits ARM anyway (see the Makefile): no runtime detection needed here.
+#if defined(__SSE2__)
+#define DEINTERLEAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DEINTERLEAVE_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+
+// Frames [firstFrame, numberOfFrames) of the channels [firstChannel, lastChannel).
+static void deinterleaveScalar(const float *interleaved, size_t firstFrame, size_t numberOfFrames,
+                               size_t numberOfChannels, size_t firstChannel, size_t lastChannel,
+                               float *const *planar){
+    for (size_t channel=firstChannel; channel<lastChannel; channel++){
+        float *out = planar[channel];
+        for (size_t i=firstFrame; i<numberOfFrames; i++){
+            out[i] = interleaved[i * numberOfChannels + channel];
+        }
+    }
+}
+
+static void deinterleaveStereo(const float *interleaved, size_t numberOfFrames, float *const *planar){
+    float *left = planar[0];
+    float *right = planar[1];
+    size_t i = 0;
+#if defined(DEINTERLEAVE_SSE2)
+    for (; i + 4 <= numberOfFrames; i += 4){
+        const __m128 a = _mm_loadu_ps(interleaved + 2*i);       // l0 r0 l1 r1
+        const __m128 b = _mm_loadu_ps(interleaved + 2*i + 4);   // l2 r2 l3 r3
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(DEINTERLEAVE_NEON)
+    for (; i + 4 <= numberOfFrames; i += 4){
+        const float32x4x2_t frames = vld2q_f32(interleaved + 2*i);
+        vst1q_f32(left + i, frames.val[0]);
+        vst1q_f32(right + i, frames.val[1]);
+    }
+#endif
+    deinterleaveScalar(interleaved, i, numberOfFrames, 2, 0, 2, planar);
+}
+
+// Each group of four channels of four consecutive frames is a 4x4 matrix,
+// transposed in registers.
+static void deinterleaveByFour(const float *interleaved, size_t numberOfFrames, size_t numberOfChannels,
+                               float *const *planar){
+    for (size_t channel=0; channel<numberOfChannels; channel+=4){
+        float *out0 = planar[channel];
+        float *out1 = planar[channel + 1];
+        float *out2 = planar[channel + 2];
+        float *out3 = planar[channel + 3];
+        size_t i = 0;
+#if defined(DEINTERLEAVE_SSE2)
+        for (; i + 4 <= numberOfFrames; i += 4){
+            const float *frame = interleaved + i * numberOfChannels + channel;
+            __m128 row0 = _mm_loadu_ps(frame);
+            __m128 row1 = _mm_loadu_ps(frame + numberOfChannels);
+            __m128 row2 = _mm_loadu_ps(frame + 2*numberOfChannels);
+            __m128 row3 = _mm_loadu_ps(frame + 3*numberOfChannels);
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+            _mm_storeu_ps(out0 + i, row0);
+            _mm_storeu_ps(out1 + i, row1);
+            _mm_storeu_ps(out2 + i, row2);
+            _mm_storeu_ps(out3 + i, row3);
+        }
+#elif defined(DEINTERLEAVE_NEON)
+        for (; i + 4 <= numberOfFrames; i += 4){
+            const float *frame = interleaved + i * numberOfChannels + channel;
+            const float32x4x2_t rows01 = vtrnq_f32(vld1q_f32(frame), vld1q_f32(frame + numberOfChannels));
+            const float32x4x2_t rows23 = vtrnq_f32(vld1q_f32(frame + 2*numberOfChannels),
+                                                   vld1q_f32(frame + 3*numberOfChannels));
+            vst1q_f32(out0 + i, vcombine_f32(vget_low_f32(rows01.val[0]), vget_low_f32(rows23.val[0])));
+            vst1q_f32(out1 + i, vcombine_f32(vget_low_f32(rows01.val[1]), vget_low_f32(rows23.val[1])));
+            vst1q_f32(out2 + i, vcombine_f32(vget_high_f32(rows01.val[0]), vget_high_f32(rows23.val[0])));
+            vst1q_f32(out3 + i, vcombine_f32(vget_high_f32(rows01.val[1]), vget_high_f32(rows23.val[1])));
+        }
+#endif
+        deinterleaveScalar(interleaved, i, numberOfFrames, numberOfChannels, channel, channel + 4, planar);
+    }
+}
+
+void deinterleave(const float *interleaved, size_t numberOfFrames, size_t numberOfChannels,
+                  float *const *planar){
+    if (numberOfChannels == 1){
+        copy(interleaved, interleaved + numberOfFrames, planar[0]);
+    } else if (numberOfChannels == 2){
+        deinterleaveStereo(interleaved, numberOfFrames, planar);
+    } else if (numberOfChannels % 4 == 0){
+        deinterleaveByFour(interleaved, numberOfFrames, numberOfChannels, planar);
+    } else {
+        deinterleaveScalar(interleaved, 0, numberOfFrames, numberOfChannels, 0, numberOfChannels, planar);
+    }
+}
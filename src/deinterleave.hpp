@@ -0,0 +1,16 @@
+#ifndef DEINTERLEAVE_HPP
+#define DEINTERLEAVE_HPP
+
+#include <cstddef>
+
+
+// Splits numberOfFrames interleaved frames into one buffer per channel :
+//   planar[channel][i] = interleaved[i * numberOfChannels + channel]
+// One channel is a plain copy. Two channels, and any multiple of four,
+// are shuffled four frames at a time with SSE2 or NEON when the build
+// has them; the other counts, and the last frames, go through a scalar
+// loop. The buffers must not overlap.
+void deinterleave(const float *interleaved, size_t numberOfFrames, size_t numberOfChannels,
+                  float *const *planar);
+
+#endif
@@ -2,8 +2,12 @@
 
 #include <SDL_image.h>
 #include <iostream>
-#include <queue>
 #include <system_error>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
 
 using namespace std;
 
@@ -53,17 +57,195 @@ auto makeResource(Creator c, Destructor d, Arguments&&... args)
 }
 
 
-Displayer::Displayer(RWQueue *lockFreeQueue,
-                     RWVectorQueue *lockFreeVectorQueue) :
-    m_lockFreeQueue(lockFreeQueue),
-    m_lockFreeVectorQueue(lockFreeVectorQueue),
-    m_sdlResource(SDLResource::getInstance()),
-    m_window(makeResource(SDL_CreateWindow, SDL_DestroyWindow, "Sebastien", 0, 0, 1400, 700, SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL)),
-    m_renderer(makeResource(SDL_CreateRenderer, SDL_DestroyRenderer, m_window.get(), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC)),
+SDLResource *initSDLResource(bool headless){
+    if (headless){
+        // must be set before SDL_Init
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    }
+    return SDLResource::getInstance();
+}
+
+const int WINDOW_WIDTH = 1400;
+const int WINDOW_HEIGHT = 700;
+const int FALLBACK_POLL_MS = 20;   // when no SDL user event is left to register
+
+const int SPECTROGRAM_ROWS = 512;        // about 4 seconds of hops at 16 kHz
+const SDL_Rect SPECTROGRAM_RECT = {430, 50, 950, 300};
+
+const SDL_Rect WAVEFORM_RECT = {10, 50, (int)ScopeFrame::NUMBER_OF_COLUMNS, 140};
+const SDL_Rect GONIOMETER_RECT = {95, 200, 150, 150};
+
+const SDL_Rect LEVEL_RECT = {350, 50, 50, 300};
+const float LEVEL_FLOOR_DBFS = -60.0f;          // the bottom of the level bars, 0 dBFS at the top
+const float TRUE_PEAK_CEILING_DBFS = -1.0f;     // above it the true peak mark turns red (EBU R 128)
+const int SPECTRUM_BANDS_Y = 390;        // the spectrum of each channel in a band below it
+const int SPECTRUM_BAR_PERCENT = 90;     // height of the bars in a band, the rest is margin
+const int SPECTRUM_LEFT = 10;
+const int SPECTRUM_STICK_WIDTH = 4;      // one stick per bin
+const int SPECTRUM_STICK_MARGIN = 1;
+
+
+// Dark blue through magenta and orange to pale yellow, one color per dB
+// step of the rows, from the floor to 0 dBFS, as ARGB8888 pixels.
+vector<Uint32> makeSpectrogramColors(){
+    const int numberOfKeys = 5;
+    const double keys[numberOfKeys][3] = {
+        {0, 0, 0},
+        {40, 0, 100},
+        {180, 20, 130},
+        {250, 120, 30},
+        {255, 250, 200}
+    };
+    const int numberOfSteps = 1 - SpectrogramRow::FLOOR_DB;
+    vector<Uint32> colors(numberOfSteps);
+    for (int i=0; i<numberOfSteps; i++){
+        const double position = (double)i * (numberOfKeys - 1) / (numberOfSteps - 1);
+        const int key = min((int)position, numberOfKeys - 2);
+        const double t = position - key;
+        Uint32 color = 0xFF000000;
+        for (int c=0; c<3; c++){
+            const Uint32 component = (Uint32)(keys[key][c] + t * (keys[key+1][c] - keys[key][c]) + 0.5);
+            color |= component << (16 - 8*c);
+        }
+        colors[i] = color;
+    }
+    return colors;
+}
+
+// From black through green to white, like the phosphor of an analog scope.
+vector<Uint32> makeGoniometerColors(){
+    vector<Uint32> colors(256);
+    for (Uint32 brightness=0; brightness<256; brightness++){
+        const Uint32 green = min(brightness * 2, (Uint32)255);
+        const Uint32 redBlue = (brightness > 127) ? (brightness - 128) * 2 : 0;
+        colors[brightness] = 0xFF000000 | (redBlue << 16) | (green << 8) | redBlue;
+    }
+    return colors;
+}
+
+
+DisplayWakeup::DisplayWakeup() :
+    m_eventType(0),
+    m_pending(false),
+    m_endOfStream(false)
+{
+}
+
+void DisplayWakeup::setEventType(Uint32 eventType){
+    m_eventType.store(eventType, memory_order_release);
+}
+
+bool DisplayWakeup::isWakeupEvent(const SDL_Event &event) const {
+    const Uint32 eventType = m_eventType.load(memory_order_relaxed);
+    return eventType != 0 && event.type == eventType;
+}
+
+// The fences order the publication of the frame before the test of
+// m_pending here, and the reset of m_pending before the read of the frame
+// in the display: either the event is pushed, or the display sees the frame.
+void DisplayWakeup::notify(){
+    const Uint32 eventType = m_eventType.load(memory_order_acquire);
+    if (eventType == 0){
+        return;
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!m_pending.exchange(true)){
+        SDL_Event event = {};
+        event.type = eventType;
+        SDL_PushEvent(&event);
+    }
+}
+
+void DisplayWakeup::acknowledge(){
+    m_pending.store(false);
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+// Set before the wakeup: the display either sees the flag before it waits,
+// or gets the event.
+void DisplayWakeup::notifyEndOfStream(){
+    m_endOfStream.store(true);
+    notify();
+}
+
+bool DisplayWakeup::isEndOfStream() const {
+    return m_endOfStream.load();
+}
+
+
+// Headless, there is no window: the software renderer draws into a surface.
+unique_ptr<SDL_Surface, SDLSurfaceDestroyerType> createHeadlessSurface(bool headless){
+    if (!headless){
+        return unique_ptr<SDL_Surface, SDLSurfaceDestroyerType>(nullptr, SDL_FreeSurface);
+    }
+    return makeResource(SDL_CreateRGBSurfaceWithFormat, SDL_FreeSurface, 0, WINDOW_WIDTH, WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+}
+
+unique_ptr<SDL_Window, SDLWindowDestroyerType> createWindow(bool headless){
+    if (headless){
+        return unique_ptr<SDL_Window, SDLWindowDestroyerType>(nullptr, SDL_DestroyWindow);
+    }
+    return makeResource(SDL_CreateWindow, SDL_DestroyWindow, "Sebastien", 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+}
+
+unique_ptr<SDL_Renderer, SDLRendererDestroyerType> createRenderer(SDL_Window *window, SDL_Surface *headlessSurface){
+    if (headlessSurface){
+        return makeResource(SDL_CreateSoftwareRenderer, SDL_DestroyRenderer, headlessSurface);
+    }
+    return makeResource(SDL_CreateRenderer, SDL_DestroyRenderer, window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+}
+
+
+Displayer::Displayer(AnalysisFeed *analysisFeed, SpectrogramFeed *spectrogramFeed, DisplayWakeup *displayWakeup,
+                     const DisplayOptions &options) :
+    m_analysisFeed(analysisFeed),
+    m_spectrogramFeed(spectrogramFeed),
+    m_displayWakeup(displayWakeup),
+    m_options(options),
+    m_sdlResource(initSDLResource(options.headless)),
+    m_headlessSurface(createHeadlessSurface(options.headless)),
+    m_window(createWindow(options.headless)),
+    m_renderer(createRenderer(m_window.get(), m_headlessSurface.get())),
     m_texture(makeResource(loadTexture, SDL_DestroyTexture, "img_test.png", m_renderer.get())),
-    m_lastFrequencyAmplitudes({})
+    m_spectrogramTexture(makeResource(SDL_CreateTexture, SDL_DestroyTexture, m_renderer.get(),
+                                      SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                      (int)analysisFeed->getFront().spectra.channels[0].size(), SPECTROGRAM_ROWS)),
+    m_spectrogramRow(0),
+    m_spectrogramColors(makeSpectrogramColors()),
+    m_goniometerTexture(makeResource(SDL_CreateTexture, SDL_DestroyTexture, m_renderer.get(),
+                                     SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                     (int)ScopeFrame::GONIOMETER_SIZE, (int)ScopeFrame::GONIOMETER_SIZE)),
+    m_goniometerColors(makeGoniometerColors()),
+    m_rmsDbfs(),
+    m_truePeaksDbfs(),
+    m_latencySumMs(0.0),
+    m_latencyMaxMs(0.0),
+    m_numberOfDisplayedFrames(0),
+    m_numberOfSkippedFrames(0),
+    m_lastSequenceNumber(0),
+    m_lastLatencyReport(chrono::steady_clock::now()),
+    m_drawTimeSumMs(0.0),
+    m_drawTimeMaxMs(0.0),
+    m_numberOfDraws(0),
+    m_numberOfDrawnFrames(0),
+    m_dumpSurface(nullptr, SDL_FreeSurface)
 {
+    if (m_options.reportRenderTimes){
+        m_renderTimesMs.reserve(m_options.numberOfFrames > 0 ? m_options.numberOfFrames : 1 << 16);
+    }
+
+    const size_t maxNumberOfBars = AnalysisFrame::MAX_NUMBER_OF_CHANNELS * m_analysisFeed->getFront().spectra.channels[0].size();
+    m_spectrumContours.reserve(maxNumberOfBars);
+    m_spectrumGauges.reserve(maxNumberOfBars);
+    m_monitoredGauges.reserve(AnalysisFrame::MAX_NUMBER_OF_CHANNELS * AnalysisFrame::MAX_NUMBER_OF_MONITORED_BINS);
+    m_monitoredAlarms.reserve(AnalysisFrame::MAX_NUMBER_OF_CHANNELS * AnalysisFrame::MAX_NUMBER_OF_MONITORED_BINS);
+    m_waveformColumns.reserve(ScopeFrame::MAX_NUMBER_OF_CHANNELS * ScopeFrame::NUMBER_OF_COLUMNS);
+    clearSpectrogram();
+    updateGoniometer(m_analysisFeed->getFront().scope);
+
     SDL_Renderer *renderer = m_renderer.get();
+    // the drawing keeps its coordinates and is scaled to the window
+    SDL_RenderSetLogicalSize(renderer, WINDOW_WIDTH, WINDOW_HEIGHT);
     SDL_SetRenderDrawColor(renderer, 100, 149, 237, 255);
 
     int flags=IMG_INIT_JPG | IMG_INIT_PNG;
@@ -81,9 +263,11 @@ Displayer::Displayer(RWQueue *lockFreeQueue,
     SDL_DisplayMode DM;
     SDL_GetCurrentDisplayMode(0, &DM);
 
-    cout << "SDL_GetWindowFlags " << endl;
-    if (SDL_GetWindowFlags(m_window.get()) | SDL_WINDOW_FULLSCREEN){
-        cout << "   SDL_WINDOW_FULLSCREEN" << endl;
+    if (m_window){
+        cout << "SDL_GetWindowFlags " << endl;
+        if (SDL_GetWindowFlags(m_window.get()) | SDL_WINDOW_FULLSCREEN){
+            cout << "   SDL_WINDOW_FULLSCREEN" << endl;
+        }
     }
 
     // SDL_GetDesktopDisplayMode
@@ -97,107 +281,422 @@ Displayer::Displayer(RWQueue *lockFreeQueue,
 Displayer::~Displayer(){
 }
 
-void Displayer::fetchLatestFrequencyAmplitudes() {
-    int ctr = 0;
-    while (m_lockFreeVectorQueue->try_dequeue(m_lastFrequencyAmplitudes)
-           && ((ctr++) < 10));
-    // cout << "Dropped : " << ctr << endl;
+bool Displayer::fetchLatestAnalysis(){
+    const bool newRows = addSpectrogramRows();
+    if (!m_analysisFeed->update()){
+        return newRows;
+    }
+    const AnalysisFrame &analysisFrame = m_analysisFeed->getFront();
+    updateLevel(analysisFrame);
+    updateGoniometer(analysisFrame.scope);
+    measureLatency(analysisFrame);
+    return true;
+}
+
+void Displayer::updateLevel(const AnalysisFrame &analysisFrame){
+    m_rmsDbfs.assign(analysisFrame.rmsDbfs, analysisFrame.rmsDbfs + analysisFrame.numberOfChannels);
+    m_truePeaksDbfs.assign(analysisFrame.truePeakDbfs, analysisFrame.truePeakDbfs + analysisFrame.numberOfChannels);
+}
+
+int Displayer::getLevelHeight(float dbfs){
+    const float level = max(0.0f, min(1.0f, (dbfs - LEVEL_FLOOR_DBFS) / -LEVEL_FLOOR_DBFS));
+    return (int)(LEVEL_RECT.h * level);
 }
 
-void Displayer::fetchLatestAverageFromQueue(){
-    double level = 0.;
-    double sum = 0.;
-    queue< double > q;
-    const int numberOfSampleToAverage = 1;
-    // //cout << "size_approx before = " << m_lockFreeQueue->size_approx() << endl;
+void Displayer::measureLatency(const AnalysisFrame &analysisFrame){
+    const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    const double latencyMs = chrono::duration< double, std::milli >(now - analysisFrame.captureTime).count();
 
-    while (m_lockFreeQueue->try_dequeue(level)){
-        sum += level;
-        q.push(level);
-        if (q.size() > numberOfSampleToAverage){
-            sum -= q.front();
-            q.pop();
+    m_latencySumMs += latencyMs;
+    m_latencyMaxMs = max(m_latencyMaxMs, latencyMs);
+    if (analysisFrame.sequenceNumber > m_lastSequenceNumber){
+        m_numberOfSkippedFrames += analysisFrame.sequenceNumber - m_lastSequenceNumber - 1;
+    }
+    m_lastSequenceNumber = analysisFrame.sequenceNumber;
+    m_numberOfDisplayedFrames++;
+
+    if (now - m_lastLatencyReport >= chrono::seconds(10)){
+        cout << "Display latency : " << (m_latencySumMs / m_numberOfDisplayedFrames) << " ms on average, "
+             << m_latencyMaxMs << " ms at most, " << m_numberOfSkippedFrames << " frames never displayed" << endl;
+        if (m_numberOfDraws > 0){
+            cout << "Frame time : " << (m_drawTimeSumMs / m_numberOfDraws) << " ms on average, "
+                 << m_drawTimeMaxMs << " ms at most, over " << m_numberOfDraws << " frames" << endl;
         }
+        m_drawTimeSumMs = 0.0;
+        m_drawTimeMaxMs = 0.0;
+        m_numberOfDraws = 0;
+        m_latencySumMs = 0.0;
+        m_latencyMaxMs = 0.0;
+        m_numberOfDisplayedFrames = 0;
+        m_numberOfSkippedFrames = 0;
+        m_lastLatencyReport = now;
+    }
+}
+
+void Displayer::measureDrawTime(chrono::steady_clock::time_point drawStart){
+    const double drawTimeMs = chrono::duration< double, std::milli >(chrono::steady_clock::now() - drawStart).count();
+    m_drawTimeSumMs += drawTimeMs;
+    m_drawTimeMaxMs = max(m_drawTimeMaxMs, drawTimeMs);
+    m_numberOfDraws++;
+    if (m_options.reportRenderTimes){
+        m_renderTimesMs.push_back(drawTimeMs);
+    }
+}
+
+// Reads back what the renderer drew, at the resolution of its output:
+// frame_NNNNNN.rgba holds the rows of RGBA pixels without padding.
+void Displayer::dumpFrame(){
+    SDL_Renderer *renderer = m_renderer.get();
+    int width, height;
+    if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0){
+        return;
+    }
+    if (!m_dumpSurface || m_dumpSurface->w != width || m_dumpSurface->h != height){
+        m_dumpSurface = makeResource(SDL_CreateRGBSurfaceWithFormat, SDL_FreeSurface, 0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+        cout << "Dumping " << width << "x" << height << " frames to " << m_options.dumpDirectory << endl;
+    }
+    SDL_Surface *surface = m_dumpSurface.get();
+    if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_RGBA32, surface->pixels, surface->pitch) != 0){
+        cout << "Unable to read the frame back: " << SDL_GetError() << endl;
+        return;
     }
 
-    //cout << "size_approx after  = " << m_lockFreeQueue->size_approx() << endl;
-    level = ((double)sum/(double)numberOfSampleToAverage);
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "frame_%06llu.%s",
+             (unsigned long long)m_numberOfDrawnFrames, m_options.dumpPng ? "png" : "rgba");
+    const string path = m_options.dumpDirectory + "/" + fileName;
 
-    if (level != 0){
-        m_level = log(level)*10;
-        if (m_level >= 100){
-            m_level = 100;
-        } else if (m_level < 0){
-            m_level = 0;
+    if (m_options.dumpPng){
+        if (IMG_SavePNG(surface, path.c_str()) != 0){
+            cout << "Unable to write " << path << ": " << IMG_GetError() << endl;
         }
-        // cout << "m_level = " << m_level << endl;
+        return;
+    }
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file){
+        cout << "Unable to write " << path << ": " << strerror(errno) << endl;
+        return;
     }
+    for (int row=0; row<height; row++){
+        fwrite((const Uint8 *)surface->pixels + row*surface->pitch, 4, width, file);
+    }
+    fclose(file);
 }
 
-void Displayer::readAndDisplay(){
-    SDL_Delay(2000);
-    SDL_Rect contour;
-    contour.x = 350; contour.y = 50;
-    contour.w = 50; contour.h = 300;
+void Displayer::reportRenderTimes(){
+    if (m_renderTimesMs.empty()){
+        return;
+    }
+    vector<double> sorted(m_renderTimesMs);
+    sort(sorted.begin(), sorted.end());
+    // nearest rank
+    auto percentile = [&sorted](double p){
+        const size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+        return sorted[rank > 0 ? rank - 1 : 0];
+    };
+    cout << "Render time over " << sorted.size() << " frames : "
+         << "p50 " << percentile(50) << " ms, "
+         << "p90 " << percentile(90) << " ms, "
+         << "p99 " << percentile(99) << " ms, "
+         << "max " << sorted.back() << " ms" << endl;
+}
 
-    SDL_Renderer *renderer = m_renderer.get();
+int Displayer::getSpectrumBarHeight(float amplitude, int height){
+    double level = amplitude*30;
+    if (level > 100) level = 100;
+    if (level < 0) level = 0;
+    return (int)((double)(height*level)/100);
+}
 
-    while (1){
-        fetchLatestAverageFromQueue();
-        fetchLatestFrequencyAmplitudes();
+// Only computes the rectangles: with one color change and one draw call
+// per rectangle, the GL driver of the Pi spent most of the frame in the
+// calls themselves.
+void Displayer::addSpectrumBars(const vector<float> &amplitudes, int curY, int height){
+    const int numberOfSticks = amplitudes.size();
+    int curX = SPECTRUM_LEFT;
 
-        SDL_SetRenderDrawColor(renderer, 0xE9, 0xF0, 0xF2, 100);
-        SDL_RenderClear(renderer);
+    SDL_Rect contour;
+    SDL_Rect jauge;
+    // the frames only carry the non-redundant half of the spectrum
+    for (int i=0; i<numberOfSticks; i++){
+        contour.x = curX; contour.y = curY;
+        contour.w = SPECTRUM_STICK_WIDTH; contour.h = height;
+        m_spectrumContours.push_back(contour);
+
+        int h = getSpectrumBarHeight(amplitudes[i], contour.h);
+        if (h > 0){
+            jauge.x = contour.x; jauge.y = contour.y + contour.h - h;
+            jauge.w = SPECTRUM_STICK_WIDTH; jauge.h = h;
+            m_spectrumGauges.push_back(jauge);
+        }
 
-        SDL_SetRenderDrawColor(renderer, 0x3F, 0x77, 0x8A, 100);
-        SDL_RenderDrawRect(renderer, &contour);
+        curX += (SPECTRUM_STICK_WIDTH+SPECTRUM_STICK_MARGIN);
+    }
+}
 
-        SDL_Rect jauge;
-        int h = (int)((double)(contour.h*m_level)/100);
-        jauge.x = contour.x; jauge.y = contour.y + contour.h - h;
-        jauge.w = 50; jauge.h = h;
+// The peak of each monitored bin during the hop, over the stick of the
+// bin, and a mark above the band while the bin is in alarm.
+void Displayer::addMonitoredBars(const AnalysisFrame &analysisFrame, size_t channel, int curY, int height){
+    for (size_t i=0; i<analysisFrame.numberOfMonitoredBins; i++){
+        const int x = SPECTRUM_LEFT + (int)analysisFrame.monitoredBins[i] * (SPECTRUM_STICK_WIDTH+SPECTRUM_STICK_MARGIN);
+        const int h = getSpectrumBarHeight(analysisFrame.monitoredAmplitudes[channel][i], height);
+        if (h > 0){
+            m_monitoredGauges.push_back(SDL_Rect{x, curY + height - h, SPECTRUM_STICK_WIDTH, h});
+        }
+        if (analysisFrame.monitoredAlarms[channel][i]){
+            m_monitoredAlarms.push_back(SDL_Rect{x - 2, curY - 6, SPECTRUM_STICK_WIDTH + 4, 4});
+        }
+    }
+}
 
-        SDL_SetRenderDrawColor(renderer, 0xFF, 0x07, 0x8A, 100);
-        SDL_RenderFillRect(renderer, &jauge);
+void Displayer::drawSpectrumBars(){
+    SDL_Renderer *renderer = m_renderer.get();
 
-        {
-            const int numberOfSticks = m_lastFrequencyAmplitudes.size();
-            const int stickWidth = 4;
-            const int stickMargin = 1;
-            int curX = 10;
-            int curY = 400;
+    SDL_SetRenderDrawColor(renderer, 0xf7, 0x85, 0xc1, 255);
+    SDL_RenderDrawRects(renderer, m_spectrumContours.data(), m_spectrumContours.size());
 
-            SDL_Rect contour;
-            SDL_Rect jauge;
-            for (int i=0; i<numberOfSticks/2; i++){
-                contour.x = curX; contour.y = curY;
-                contour.w = stickWidth; contour.h = 150;
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0x07, 0x8A, 100);
+    SDL_RenderFillRects(renderer, m_spectrumGauges.data(), m_spectrumGauges.size());
 
-                SDL_SetRenderDrawColor(renderer, 0xf7, 0x85, 0xc1, 255);
-                SDL_RenderDrawRect(renderer, &contour);
+    SDL_SetRenderDrawColor(renderer, 0xF0, 0x90, 0x10, 255);
+    SDL_RenderFillRects(renderer, m_monitoredGauges.data(), m_monitoredGauges.size());
+    SDL_SetRenderDrawColor(renderer, 0xE0, 0x10, 0x10, 255);
+    SDL_RenderFillRects(renderer, m_monitoredAlarms.data(), m_monitoredAlarms.size());
 
+    m_spectrumContours.clear();
+    m_spectrumGauges.clear();
+    m_monitoredGauges.clear();
+    m_monitoredAlarms.clear();
+}
 
-                double level = m_lastFrequencyAmplitudes[i]*30;
-                if (level > 100) level = 100;
-                if (level < 0) level = 0;
-                int h = (int)((double)(contour.h*level)/100);
-                jauge.x = contour.x; jauge.y = contour.y + contour.h - h;
-                jauge.w = stickWidth; jauge.h = h;
+void Displayer::readAndDisplay(){
+    if (m_window){
+        SDL_Delay(2000);
+    }
+    const Uint32 eventType = SDL_RegisterEvents(1);
+    const bool wakeupRegistered = (eventType != (Uint32)-1);
+    if (wakeupRegistered){
+        m_displayWakeup->setEventType(eventType);
+    }
 
-                SDL_SetRenderDrawColor(renderer, 0xFF, 0x07, 0x8A, 100);
-                SDL_RenderFillRect(renderer, &jauge);
+    bool running = true;
+    bool needsRedraw = true;
+    SDL_Event event;
 
-                curX += (stickWidth+stickMargin);
+    while (true){
+        if (needsRedraw){
+            draw();
+            needsRedraw = false;
+            if (m_options.numberOfFrames > 0 && m_numberOfDrawnFrames >= m_options.numberOfFrames){
+                break;
             }
         }
+        if (!running){
+            break;
+        }
+        if (m_displayWakeup->isEndOfStream()){
+            // the last frame is drawn before leaving
+            needsRedraw = fetchLatestAnalysis();
+            running = false;
+            continue;
+        }
+        const int gotEvent = wakeupRegistered ? SDL_WaitEvent(&event) : SDL_WaitEventTimeout(&event, FALLBACK_POLL_MS);
+        if (!gotEvent){
+            needsRedraw = fetchLatestAnalysis();
+            continue;
+        }
+        // everything pending is handled before drawing once
+        do {
+            needsRedraw |= handleEvent(event, running);
+        } while (SDL_PollEvent(&event));
+    }
+    if (m_options.reportRenderTimes){
+        reportRenderTimes();
+    }
+}
+
+// Returns true when the window has to be redrawn.
+bool Displayer::handleEvent(const SDL_Event &event, bool &running){
+    if (m_displayWakeup->isWakeupEvent(event)){
+        m_displayWakeup->acknowledge();
+        return fetchLatestAnalysis();
+    }
+    switch (event.type){
+    case SDL_QUIT:
+        running = false;
+        return false;
+    case SDL_WINDOWEVENT:
+        return event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED
+            || event.window.event == SDL_WINDOWEVENT_EXPOSED;
+    default:
+        return false;
+    }
+}
 
+void Displayer::clearSpectrogram(){
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(m_spectrogramTexture.get(), NULL, &pixels, &pitch) != 0){
+        return;
+    }
+    const size_t width = m_analysisFeed->getFront().spectra.channels[0].size();
+    for (int row=0; row<SPECTROGRAM_ROWS; row++){
+        Uint32 *destination = (Uint32 *)((Uint8 *)pixels + row*pitch);
+        fill(destination, destination + width, m_spectrogramColors[0]);
+    }
+    SDL_UnlockTexture(m_spectrogramTexture.get());
+}
 
+// Every row queued since the previous wakeup, oldest first.
+bool Displayer::addSpectrogramRows(){
+    bool added = false;
+    SpectrogramRow *spectrogramRow;
+    while ((spectrogramRow = m_spectrogramFeed->peek())){
+        addSpectrogramRow(*spectrogramRow);
+        m_spectrogramFeed->pop();
+        added = true;
+    }
+    return added;
+}
 
-        SDL_RenderPresent(renderer);
+void Displayer::addSpectrogramRow(const SpectrogramRow &spectrogramRow){
+    const size_t numberOfBins = spectrogramRow.numberOfBins;
+    m_spectrogramRow = (m_spectrogramRow == 0 ? SPECTROGRAM_ROWS : m_spectrogramRow) - 1;
 
-        SDL_Delay(20);
+    SDL_Rect row = {0, m_spectrogramRow, (int)numberOfBins, 1};
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(m_spectrogramTexture.get(), &row, &pixels, &pitch) != 0){
+        return;
+    }
+    Uint32 *destination = (Uint32 *)pixels;
+    for (size_t k=0; k<numberOfBins; k++){
+        destination[k] = m_spectrogramColors[spectrogramRow.steps[k]];
     }
+    SDL_UnlockTexture(m_spectrogramTexture.get());
+}
+
+// The rows from the newest one to the end of the texture go on top, the
+// older rows from the start of the texture below them.
+void Displayer::drawSpectrogram(){
+    SDL_Renderer *renderer = m_renderer.get();
+    const int width = (int)m_analysisFeed->getFront().spectra.channels[0].size();
+    const int newestRows = SPECTROGRAM_ROWS - m_spectrogramRow;
+    const int topHeight = SPECTROGRAM_RECT.h * newestRows / SPECTROGRAM_ROWS;
+
+    SDL_Rect source = {0, m_spectrogramRow, width, newestRows};
+    SDL_Rect destination = {SPECTROGRAM_RECT.x, SPECTROGRAM_RECT.y, SPECTROGRAM_RECT.w, topHeight};
+    SDL_RenderCopy(renderer, m_spectrogramTexture.get(), &source, &destination);
+
+    if (m_spectrogramRow > 0){
+        source = {0, 0, width, m_spectrogramRow};
+        destination = {SPECTROGRAM_RECT.x, SPECTROGRAM_RECT.y + topHeight, SPECTROGRAM_RECT.w, SPECTROGRAM_RECT.h - topHeight};
+        SDL_RenderCopy(renderer, m_spectrogramTexture.get(), &source, &destination);
+    }
+}
+
+void Displayer::updateGoniometer(const ScopeFrame &scope){
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(m_goniometerTexture.get(), NULL, &pixels, &pitch) != 0){
+        return;
+    }
+    const size_t size = ScopeFrame::GONIOMETER_SIZE;
+    for (size_t row=0; row<size; row++){
+        const uint8_t *brightness = &scope.goniometer[row * size];
+        Uint32 *destination = (Uint32 *)((Uint8 *)pixels + row*pitch);
+        for (size_t column=0; column<size; column++){
+            destination[column] = m_goniometerColors[brightness[column]];
+        }
+    }
+    SDL_UnlockTexture(m_goniometerTexture.get());
+}
+
+// One bar per column from its minimum to its maximum, a band per channel,
+// submitted in one call like the spectrum bars.
+void Displayer::drawScope(){
+    SDL_Renderer *renderer = m_renderer.get();
+    const ScopeFrame &scope = m_analysisFeed->getFront().scope;
+    const int bandHeight = WAVEFORM_RECT.h / (int)scope.numberOfChannels;
+
+    SDL_SetRenderDrawColor(renderer, 0x10, 0x18, 0x10, 255);
+    SDL_RenderFillRect(renderer, &WAVEFORM_RECT);
+
+    for (size_t channel=0; channel<scope.numberOfChannels; channel++){
+        const int halfHeight = bandHeight / 2;
+        const int centerY = WAVEFORM_RECT.y + (int)channel * bandHeight + halfHeight;
+        for (size_t column=0; column<ScopeFrame::NUMBER_OF_COLUMNS; column++){
+            const float minimum = max(-1.0f, min(1.0f, scope.minimum[channel][column]));
+            const float maximum = max(-1.0f, min(1.0f, scope.maximum[channel][column]));
+            const int top = centerY - (int)(maximum * halfHeight);
+            const int bottom = centerY - (int)(minimum * halfHeight);
+            SDL_Rect bar = {WAVEFORM_RECT.x + (int)column, top, 1, max(1, bottom - top + 1)};
+            m_waveformColumns.push_back(bar);
+        }
+    }
+    SDL_SetRenderDrawColor(renderer, 0x40, 0xFF, 0x40, 255);
+    SDL_RenderFillRects(renderer, m_waveformColumns.data(), m_waveformColumns.size());
+    m_waveformColumns.clear();
 
+    SDL_RenderCopy(renderer, m_goniometerTexture.get(), NULL, &GONIOMETER_RECT);
 }
 
+void Displayer::draw(){
+    const chrono::steady_clock::time_point drawStart = chrono::steady_clock::now();
+
+    SDL_Renderer *renderer = m_renderer.get();
+
+    SDL_SetRenderDrawColor(renderer, 0xE9, 0xF0, 0xF2, 100);
+    SDL_RenderClear(renderer);
+
+    SDL_SetRenderDrawColor(renderer, 0x3F, 0x77, 0x8A, 100);
+    SDL_RenderDrawRect(renderer, &LEVEL_RECT);
+
+    // the level bar shared by the channels, side by side
+    const int levelWidth = LEVEL_RECT.w / max(1, (int)m_rmsDbfs.size());
+    for (size_t channel=0; channel<m_rmsDbfs.size(); channel++){
+        SDL_Rect jauge;
+        int h = getLevelHeight(m_rmsDbfs[channel]);
+        jauge.x = LEVEL_RECT.x + (int)channel*levelWidth; jauge.y = LEVEL_RECT.y + LEVEL_RECT.h - h;
+        jauge.w = levelWidth; jauge.h = h;
+        SDL_SetRenderDrawColor(renderer, 0xFF, 0x07, 0x8A, 100);
+        SDL_RenderFillRect(renderer, &jauge);
+
+        const int truePeakHeight = getLevelHeight(m_truePeaksDbfs[channel]);
+        if (truePeakHeight > 0){
+            SDL_Rect mark = {jauge.x, LEVEL_RECT.y + LEVEL_RECT.h - truePeakHeight, levelWidth, 2};
+            if (m_truePeaksDbfs[channel] > TRUE_PEAK_CEILING_DBFS){
+                SDL_SetRenderDrawColor(renderer, 0xE0, 0x10, 0x10, 255);
+            } else {
+                SDL_SetRenderDrawColor(renderer, 0x3F, 0x77, 0x8A, 255);
+            }
+            SDL_RenderFillRect(renderer, &mark);
+        }
+    }
 
+    const AnalysisFrame &analysisFrame = m_analysisFeed->getFront();
+    const SpectrumFrame &spectra = analysisFrame.spectra;
+    if (spectra.numberOfChannels == 1){
+        addSpectrumBars(spectra.channels[0], 400, 150);
+        addMonitoredBars(analysisFrame, 0, 400, 150);
+    } else {
+        // the bands share the bottom of the window
+        const int bandSpacing = (WINDOW_HEIGHT - SPECTRUM_BANDS_Y) / (int)spectra.numberOfChannels;
+        const int barHeight = bandSpacing * SPECTRUM_BAR_PERCENT / 100;
+        for (size_t channel=0; channel<spectra.numberOfChannels; channel++){
+            addSpectrumBars(spectra.channels[channel], SPECTRUM_BANDS_Y + (int)channel*bandSpacing, barHeight);
+            addMonitoredBars(analysisFrame, channel, SPECTRUM_BANDS_Y + (int)channel*bandSpacing, barHeight);
+        }
+    }
+    drawSpectrumBars();
+    drawSpectrogram();
+    drawScope();
+
+    measureDrawTime(drawStart);
+    m_numberOfDrawnFrames++;
+    // the content of the back buffer is undefined after the present
+    if (!m_options.dumpDirectory.empty()){
+        dumpFrame();
+    }
+    SDL_RenderPresent(renderer);
+}
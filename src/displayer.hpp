@@ -6,10 +6,15 @@
 #include <SDL.h>
 #include <memory>
 #include <vector>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include <string>
 
 using SDLWindowDestroyerType = void (*)(SDL_Window*);
 using SDLRendererDestroyerType = void (*)(SDL_Renderer*);
 using SDLTextureDestroyerType = void (*)(SDL_Texture*);
+using SDLSurfaceDestroyerType = void (*)(SDL_Surface*);
 
 
 // Singleton that takes care of C-style resource : SDL_Init SDL_Quit
@@ -23,23 +28,119 @@ private:
 };
 
 
+// Wakes the display loop from another thread through an SDL user event.
+// At most one event is pending at a time, so that a fast producer cannot
+// flood the event queue: when the display handles it, it reads the newest
+// frame, whatever the number of frames published in between.
+class DisplayWakeup {
+public:
+    DisplayWakeup();
+    void setEventType(Uint32 eventType);
+    bool isWakeupEvent(const SDL_Event &event) const;
+    void notify();        // any thread, after publishing a frame
+    void acknowledge();   // display thread, before reading the frame
+
+    // Any thread, after publishing the last frame of a file or a generator:
+    // the display draws it and returns.
+    void notifyEndOfStream();
+    bool isEndOfStream() const;
+private:
+    std::atomic<Uint32> m_eventType;   // 0 until the display registers it
+    std::atomic<bool> m_pending;
+    std::atomic<bool> m_endOfStream;
+};
+
+
+// How the display runs. By default it opens a window and runs until the
+// window is closed.
+struct DisplayOptions {
+    bool headless = false;            // SDL dummy video driver, software rendering into a surface
+    uint64_t numberOfFrames = 0;      // stop after drawing that many frames, 0 for never
+    std::string dumpDirectory;        // when not empty, every drawn frame is written there
+    bool dumpPng = false;             // PNG files instead of raw RGBA
+    bool reportRenderTimes = false;   // render time percentiles when the display stops
+};
+
+
+// The display loop sleeps in SDL_WaitEvent and redraws only when a new
+// analysis frame arrived or the window needs it.
+// Next to the bars, a spectrogram shows the recent history of the
+// spectra: its texture is a circular buffer of rows, one row per analysis
+// frame, newest at the top. The rows come through their own queue, so that
+// the time axis follows the hops whatever the refresh rate: each wakeup
+// writes all the pending ones, each over the oldest row, and the texture
+// is drawn as two copies split at the newest row.
+// The level bar and the spectrum bars are split into one per channel, as
+// many as the input has. Each level bar shows the RMS in dBFS, with a mark
+// at the true peak.
+// The bins monitored by the Analyzer show their peak over their stick, in
+// orange, with a red mark above while they are in alarm.
+// On the left, an oscilloscope draws one min/max bar per column of the
+// waveform, and a goniometer uploads its point cloud into a texture once
+// per analysis frame: both cost the same whatever the sample rate.
 class Displayer {
 public:
-    explicit Displayer(RWQueue *lockFreeQueue, RWVectorQueue *lockFreeVectorQueue);
+    explicit Displayer(AnalysisFeed *analysisFeed, SpectrogramFeed *spectrogramFeed, DisplayWakeup *displayWakeup,
+                       const DisplayOptions &options = DisplayOptions());
     ~Displayer();
     void readAndDisplay();
 private:
     Displayer(const Displayer &);
-    RWQueue *m_lockFreeQueue;
-    RWVectorQueue *m_lockFreeVectorQueue;
+    AnalysisFeed *m_analysisFeed;
+    SpectrogramFeed *m_spectrogramFeed;
+    DisplayWakeup *m_displayWakeup;
+    DisplayOptions m_options;
     std::unique_ptr<SDLResource> m_sdlResource;
-    std::unique_ptr<SDL_Window, SDLWindowDestroyerType> m_window;
+    std::unique_ptr<SDL_Surface, SDLSurfaceDestroyerType> m_headlessSurface;   // the render target when headless
+    std::unique_ptr<SDL_Window, SDLWindowDestroyerType> m_window;              // null when headless
     std::unique_ptr<SDL_Renderer, SDLRendererDestroyerType> m_renderer;
     std::unique_ptr<SDL_Texture, SDLTextureDestroyerType> m_texture;
-    std::vector<double> m_lastFrequencyAmplitudes;
-    double m_level;
-    void fetchLatestAverageFromQueue();
-    void fetchLatestFrequencyAmplitudes();
+    std::unique_ptr<SDL_Texture, SDLTextureDestroyerType> m_spectrogramTexture;
+    int m_spectrogramRow;                        // row of the newest spectrum
+    std::vector<Uint32> m_spectrogramColors;     // color of each dB step, from the floor to 0 dBFS
+    std::unique_ptr<SDL_Texture, SDLTextureDestroyerType> m_goniometerTexture;
+    std::vector<Uint32> m_goniometerColors;      // color of each brightness
+    std::vector<SDL_Rect> m_waveformColumns;
+    std::vector<float> m_rmsDbfs;               // of each channel
+    std::vector<float> m_truePeaksDbfs;
+    // end-to-end latency of the displayed frames, and the frames never displayed
+    double m_latencySumMs;
+    double m_latencyMaxMs;
+    uint64_t m_numberOfDisplayedFrames;
+    uint64_t m_numberOfSkippedFrames;
+    uint64_t m_lastSequenceNumber;
+    std::chrono::steady_clock::time_point m_lastLatencyReport;
+    // time spent building and submitting a frame, SDL_RenderPresent excluded
+    double m_drawTimeSumMs;
+    double m_drawTimeMaxMs;
+    uint64_t m_numberOfDraws;
+    uint64_t m_numberOfDrawnFrames;
+    std::vector<double> m_renderTimesMs;        // every frame, when reportRenderTimes
+    std::unique_ptr<SDL_Surface, SDLSurfaceDestroyerType> m_dumpSurface;
+    // the bars of all the spectra, submitted in one call per color
+    std::vector<SDL_Rect> m_spectrumContours;
+    std::vector<SDL_Rect> m_spectrumGauges;
+    std::vector<SDL_Rect> m_monitoredGauges;
+    std::vector<SDL_Rect> m_monitoredAlarms;
+    bool handleEvent(const SDL_Event &event, bool &running);
+    bool fetchLatestAnalysis();
+    void draw();
+    void updateLevel(const AnalysisFrame &analysisFrame);
+    static int getLevelHeight(float dbfs);
+    void measureLatency(const AnalysisFrame &analysisFrame);
+    void measureDrawTime(std::chrono::steady_clock::time_point drawStart);
+    void dumpFrame();
+    void reportRenderTimes();
+    static int getSpectrumBarHeight(float amplitude, int height);
+    void addSpectrumBars(const std::vector<float> &amplitudes, int curY, int height);
+    void addMonitoredBars(const AnalysisFrame &analysisFrame, size_t channel, int curY, int height);
+    void drawSpectrumBars();
+    void clearSpectrogram();
+    bool addSpectrogramRows();
+    void addSpectrogramRow(const SpectrogramRow &spectrogramRow);
+    void drawSpectrogram();
+    void updateGoniometer(const ScopeFrame &scope);
+    void drawScope();
 };
 
 #endif
@@ -9,17 +9,88 @@ bool isPowerOfTwo(size_t val){
     return ((val & (val-1)) == 0);
 }
 
-size_t adjustedNumberOfPoints(size_t numberOfPoints){
-    while (!isPowerOfTwo(numberOfPoints)){
-        numberOfPoints++;
+size_t nextPowerOfTwo(size_t val){
+    size_t powerOfTwo = 1;
+    while (powerOfTwo < val){
+        powerOfTwo <<= 1;
     }
-    return numberOfPoints;
+    return powerOfTwo;
 }
 
-Complex computeOmega(size_t numberOfPoints){
+// Splits numberOfPoints into the radices of the mixed radix algorithm,
+// preferring 4 which needs fewer operations than two passes of 2.
+// The part that cannot be split, 1 if there is none, is left in numberOfPoints.
+vector< size_t > factorize(size_t &numberOfPoints){
+    vector< size_t > factors;
+    for (size_t radix : {4, 2, 3, 5}){
+        while (numberOfPoints > 1 && numberOfPoints % radix == 0){
+            factors.push_back(radix);
+            numberOfPoints /= radix;
+        }
+    }
+    return factors;
+}
+
+// omega^k for k in [0, count), omega being the root of order numberOfPoints.
+// Each entry is computed directly rather than by repeated multiplication so
+// that rounding errors do not accumulate.
+template < typename T >
+vector< complex< T > > computeTwiddles(size_t numberOfPoints, size_t count, bool inverse){
     static const double pi = std::acos(-1);
+    const double sign = inverse ? -1.0 : 1.0;
+    vector< complex< T > > twiddles(count);
+
+    for (size_t k=0; k<count; k++){
+        const double angle = sign * 2.0 * pi * (double)k / (double)numberOfPoints;
+        twiddles[k] = complex< T >((T)cos(angle), (T)sin(angle));
+    }
+    return twiddles;
+}
+
+// The twiddles of every radix-2 stage, one contiguous block per stage.
+template < typename T >
+vector< complex< T > > computeStageTwiddles(size_t numberOfPoints, bool inverse){
+    vector< complex< T > > twiddles;
+
+    for (size_t half=1; half<numberOfPoints; half*=2){
+        const auto stageTwiddles = computeTwiddles< T >(2*half, half, inverse);
+        twiddles.insert(twiddles.end(), stageTwiddles.begin(), stageTwiddles.end());
+    }
+    return twiddles;
+}
+
+// b[k] = omega^(k*k/2), with k*k reduced modulo 2n before the conversion
+// to a floating point angle to stay accurate for large k.
+template < typename T >
+vector< complex< T > > computeChirp(size_t numberOfPoints){
+    static const double pi = std::acos(-1);
+    vector< complex< T > > chirp(numberOfPoints);
+
+    for (size_t k=0; k<numberOfPoints; k++){
+        const size_t square = (k*k) % (2*numberOfPoints);
+        const double angle = pi * (double)square / (double)numberOfPoints;
+        chirp[k] = complex< T >((T)cos(angle), (T)sin(angle));
+    }
+    return chirp;
+}
+
+vector<size_t> computeBitReversal(size_t numberOfPoints){
+    vector<size_t> bitReversal(numberOfPoints, 0);
+    size_t numberOfBits = 0;
+    while (((size_t)1 << numberOfBits) < numberOfPoints){
+        numberOfBits++;
+    }
 
-    return exp(2i * pi / (double)numberOfPoints);
+    for (size_t i=0; i<numberOfPoints; i++){
+        size_t reversed = 0;
+        for (size_t bit=0; bit<numberOfBits; bit++){
+            if (i & ((size_t)1 << bit)){
+                reversed |= (size_t)1 << (numberOfBits - 1 - bit);
+            }
+        }
+        bitReversal[i] = reversed;
+    }
+    return bitReversal;
 }
 
 ComplexPolynomial::ComplexPolynomial(const Polynomial &p){
@@ -59,15 +130,191 @@ void FFT::displayComplexPolynomialAbs(const ComplexPolynomial &p){
 
 
 
+template < typename T >
+FFTEngine< T >::FFTEngine(size_t numberOfPoints, const FFTKernels< T > &kernels) :
+    m_numberOfPoints(numberOfPoints),
+    m_kernels(&kernels),
+    m_algorithm(radix2)
+{
+    size_t remainder = numberOfPoints;
+    if (isPowerOfTwo(numberOfPoints)){
+        m_algorithm = radix2;
+        m_bitReversal = computeBitReversal(numberOfPoints);
+        m_twiddles = computeStageTwiddles< T >(numberOfPoints, false);
+        m_inverseTwiddles = computeStageTwiddles< T >(numberOfPoints, true);
+    } else if (m_factors = factorize(remainder), remainder == 1){
+        m_algorithm = mixedRadix;
+        m_twiddles = computeTwiddles< T >(numberOfPoints, numberOfPoints, false);
+        m_inverseTwiddles = computeTwiddles< T >(numberOfPoints, numberOfPoints, true);
+    } else {
+        m_algorithm = bluestein;
+        m_factors.clear();
+
+        const size_t convolutionSize = nextPowerOfTwo(2*numberOfPoints - 1);
+        m_convolutionEngine.reset(new FFTEngine< T >(convolutionSize, kernels));
+        m_convolutionInput.resize(convolutionSize);
+        m_convolutionOutput.resize(convolutionSize);
+        m_chirp = computeChirp< T >(numberOfPoints);
+
+        // The spectrum of conj(b), laid out for a circular convolution
+        // (negative indices at the end), with the 1/size of the inverse
+        // transform folded in. The inverse transform uses conj(b) as its
+        // chirp, hence b for this one.
+        const T scale = (T)1 / (T)convolutionSize;
+        for (bool inverse : {false, true}){
+            vector< complex< T > > &spectrum = inverse ? m_inverseChirpSpectrum : m_chirpSpectrum;
+            fill(m_convolutionInput.begin(), m_convolutionInput.end(), complex< T >());
+            for (size_t k=0; k<numberOfPoints; k++){
+                const complex< T > value = inverse ? m_chirp[k] * scale : conj(m_chirp[k]) * scale;
+                m_convolutionInput[k] = value;
+                if (k){
+                    m_convolutionInput[convolutionSize - k] = value;
+                }
+            }
+            spectrum.resize(convolutionSize);
+            m_convolutionEngine->eval(m_convolutionInput.data(), spectrum.data(), false);
+        }
+    }
+}
+
+template < typename T >
+void FFTEngine< T >::eval(const complex< T > *in, complex< T > *out, bool inverse){
+    switch (m_algorithm){
+    case radix2:
+        evalRadix2(in, out, inverse);
+        break;
+    case mixedRadix:
+        evalMixedRadix(in, out, 1, 0, m_numberOfPoints, inverse ? m_inverseTwiddles.data() : m_twiddles.data());
+        break;
+    case bluestein:
+        evalBluestein(in, out, inverse);
+        break;
+    }
+}
+
+// Radix-2 decimation in time. The coefficients are loaded in bit-reversed
+// order, then every stage combines pairs of half-size transforms in place:
+//   out[i]       = even[i] + omega^i * odd[i]
+//   out[i + n/2] = even[i] - omega^i * odd[i]
+// (since omega^(i+n/2) = -omega^i, see : https://imgur.com/ZAPGXJ9)
+// The inverse transform uses the conjugate roots.
+template < typename T >
+void FFTEngine< T >::evalRadix2(const complex< T > *in, complex< T > *out, bool inverse){
+    const size_t n = m_numberOfPoints;
+    const complex< T > *twiddles = inverse ? m_inverseTwiddles.data() : m_twiddles.data();
+
+    for (size_t i=0; i<n; i++){
+        out[i] = in[m_bitReversal[i]];
+    }
+
+    for (size_t half=1; half<n; half*=2){
+        m_kernels->butterflyStage(out, n, half, twiddles + half - 1);
+    }
+}
+
+// Mixed radix decimation in time. A transform of n = p*m points, whose
+// input is read every inStride points, is made of the p transforms of m
+// points of the inputs congruent to q modulo p, written at out + q*m, then
+// combined by a butterfly of radix p :
+//   X[k] = sum over q of omega_n^(q*k) * S_q[k mod m]
+// omega_n being omega^(N/n), read from the twiddles of the full transform.
+template < typename T >
+void FFTEngine< T >::evalMixedRadix(const complex< T > *in, complex< T > *out, size_t inStride,
+                                    size_t factorIndex, size_t n, const complex< T > *twiddles){
+    const size_t p = m_factors[factorIndex];
+    const size_t m = n/p;
+    const size_t twiddleStride = m_numberOfPoints/n;
+
+    if (m == 1){
+        for (size_t q=0; q<p; q++){
+            out[q] = in[q*inStride];
+        }
+    } else {
+        for (size_t q=0; q<p; q++){
+            evalMixedRadix(in + q*inStride, out + q*m, inStride*p, factorIndex+1, m, twiddles);
+        }
+    }
+
+    if (p == 2){
+        for (size_t u=0; u<m; u++){
+            const complex< T > t = complexMultiply(out[u+m], twiddles[u*twiddleStride]);
+            out[u+m] = out[u] - t;
+            out[u] = out[u] + t;
+        }
+    } else if (p == 4){
+        // omega_n^m is the fourth root of unity j (i, or -i for the inverse)
+        const complex< T > j = twiddles[m*twiddleStride];
+        for (size_t u=0; u<m; u++){
+            const complex< T > s0 = out[u];
+            const complex< T > s1 = complexMultiply(out[u+m], twiddles[u*twiddleStride]);
+            const complex< T > s2 = complexMultiply(out[u+2*m], twiddles[2*u*twiddleStride]);
+            const complex< T > s3 = complexMultiply(out[u+3*m], twiddles[3*u*twiddleStride]);
+            const complex< T > jDiff = complexMultiply(j, s1 - s3);
+            out[u]     = (s0 + s2) + (s1 + s3);
+            out[u+m]   = (s0 - s2) + jDiff;
+            out[u+2*m] = (s0 + s2) - (s1 + s3);
+            out[u+3*m] = (s0 - s2) - jDiff;
+        }
+    } else {
+        // radices 3 and 5 : direct evaluation of the small DFT
+        complex< T > scratch[5];
+        for (size_t u=0; u<m; u++){
+            for (size_t q=0; q<p; q++){
+                scratch[q] = complexMultiply(out[u+q*m], twiddles[q*u*twiddleStride]);
+            }
+            // what is left of omega_n^(q*k) once omega_n^(q*u) is applied
+            // is the root of order p omega_n^(q*q1*m)
+            for (size_t q1=0; q1<p; q1++){
+                complex< T > sum = scratch[0];
+                for (size_t q=1; q<p; q++){
+                    sum += complexMultiply(scratch[q], twiddles[((q*q1) % p) * m * twiddleStride]);
+                }
+                out[u + q1*m] = sum;
+            }
+        }
+    }
+}
+
+// Bluestein : since q*k = (q*q + k*k - (k-q)*(k-q)) / 2,
+//   X[k] = b[k] * sum over q of (x[q] * b[q]) * conj(b[k-q])
+// with b[k] = omega^(k*k/2). The sum is a convolution, computed by a
+// power-of-two transform of at least 2n-1 points.
+template < typename T >
+void FFTEngine< T >::evalBluestein(const complex< T > *in, complex< T > *out, bool inverse){
+    const size_t n = m_numberOfPoints;
+    const complex< T > *spectrum = inverse ? m_inverseChirpSpectrum.data() : m_chirpSpectrum.data();
+
+    for (size_t k=0; k<n; k++){
+        const complex< T > chirp = inverse ? conj(m_chirp[k]) : m_chirp[k];
+        m_convolutionInput[k] = complexMultiply(in[k], chirp);
+    }
+    fill(m_convolutionInput.begin() + n, m_convolutionInput.end(), complex< T >());
+
+    m_convolutionEngine->eval(m_convolutionInput.data(), m_convolutionOutput.data(), false);
+    for (size_t k=0; k<m_convolutionOutput.size(); k++){
+        m_convolutionOutput[k] = complexMultiply(m_convolutionOutput[k], spectrum[k]);
+    }
+    m_convolutionEngine->eval(m_convolutionOutput.data(), m_convolutionInput.data(), true);
+
+    for (size_t k=0; k<n; k++){
+        const complex< T > chirp = inverse ? conj(m_chirp[k]) : m_chirp[k];
+        out[k] = complexMultiply(m_convolutionInput[k], chirp);
+    }
+}
+
+template class FFTEngine< double >;
+template class FFTEngine< float >;
+
+
+
 FFT::FFT(const ComplexPolynomial &p, size_t numberOfPoints) :
-    m_numberOfPoints(adjustedNumberOfPoints(numberOfPoints)),
-    m_omega(computeOmega(m_numberOfPoints)),
+    m_engine(numberOfPoints),
+    m_inverseScale(m_engine.size() ? 1.0/(double)m_engine.size() : 0.0),
     m_coefs(p),
-    m_buffer(ComplexPolynomial(m_numberOfPoints)),
-    m_evalResults(ComplexPolynomial(m_numberOfPoints)),
-    m_frequentialAmplitudes(m_numberOfPoints)
+    m_evalResults(ComplexPolynomial(m_engine.size())),
+    m_frequentialAmplitudes(m_engine.size())
 {
-    m_coefs.resize(m_numberOfPoints, Complex(0, 0));
+    m_coefs.resize(m_engine.size(), Complex(0, 0));
 }
 
 void FFT::setValue(size_t index, const Complex value){
@@ -75,69 +322,77 @@ void FFT::setValue(size_t index, const Complex value){
 }
 
 const vector<double> &FFT::computeFrequentialAmplitudes() {
-    fastEvalWithBuffer(0,
-                       1,
-                       m_omega,
-                       m_numberOfPoints,
-                       0,
-                       m_evalResults,
-                       m_buffer);
-    transform(m_evalResults.begin(), m_evalResults.end(), m_frequentialAmplitudes.begin(), [this](const Complex &c){
-        return abs(c);
-    });
+    computeEval();
+    m_engine.kernels().magnitudes(m_evalResults.data(), m_frequentialAmplitudes.data(), m_evalResults.size());
 
     return m_frequentialAmplitudes;
 }
 
-ComplexPolynomial FFT::computeEval(){
-    fastEvalWithBuffer(0,
-                       1,
-                       m_omega,
-                       m_numberOfPoints,
-                       0,
-                       m_evalResults,
-                       m_buffer);
+const ComplexPolynomial &FFT::computeEval(){
+    m_engine.eval(m_coefs.data(), m_evalResults.data(), false);
     return m_evalResults;
 }
-ComplexPolynomial FFT::computeEvalInverse(){
-    fastEvalWithBuffer(0,
-                       1,
-                       pow(m_omega, -1),
-                       m_numberOfPoints,
-                       0,
-                       m_evalResults,
-                       m_buffer);
-    transform(m_evalResults.begin(), m_evalResults.end(), m_evalResults.begin(), [this](const Complex &c){
-        return c/((double)this->m_numberOfPoints);
-    });
+const ComplexPolynomial &FFT::computeEvalInverse(){
+    m_engine.eval(m_coefs.data(), m_evalResults.data(), true);
+    m_engine.kernels().scale(m_evalResults.data(), m_inverseScale, m_evalResults.size());
     return m_evalResults;
 }
 
 
 
-void FFT::fastEvalWithBuffer(size_t start, size_t step, Complex omega, size_t n, size_t outOffset, ComplexPolynomial &out, ComplexPolynomial &buffer){
-    if (n == 1){
-        Complex val;
-        if (start < m_coefs.size()){
-            val = m_coefs[start];
-        }
-        out[outOffset] = val;
-        return;
+template < typename T >
+BasicRealFFT< T >::BasicRealFFT(const vector< T > &p, size_t numberOfPoints) :
+    m_numberOfPoints(max(numberOfPoints + (numberOfPoints & 1), (size_t)2)),
+    m_halfSizeEngine(m_numberOfPoints/2),
+    m_packed(m_numberOfPoints/2),
+    m_halfSizeResults(m_numberOfPoints/2),
+    m_twiddles(computeTwiddles< T >(m_numberOfPoints, m_numberOfPoints/2 + 1, false)),
+    m_evalResults(m_numberOfPoints/2 + 1),
+    m_frequentialAmplitudes(m_numberOfPoints/2 + 1)
+{
+    for (size_t i=0; i<min(p.size(), m_numberOfPoints); i++){
+        setValue(i, p[i]);
     }
+}
 
-    fastEvalWithBuffer(start, step*2, pow(omega, 2), n/2, outOffset, out, buffer);
-    fastEvalWithBuffer(start+step, step*2, pow(omega, 2), n/2, outOffset+n/2, out, buffer);
-
-    for (size_t i=0; i<n/2; i++){
-        buffer[i] = out[outOffset+i] + pow(omega, i) * out[outOffset+n/2+i];
-        buffer[i+n/2] = out[outOffset+i] - pow(omega, i) * out[outOffset+n/2+i];
-        // the same as :
-        //   buffer[i+n/2] = out[outOffset+i] - pow(omega, i+n/2) * out[outOffset+n/2+i];
-        // see : https://imgur.com/ZAPGXJ9
+template < typename T >
+void BasicRealFFT< T >::setValue(size_t index, T value){
+    complex< T > &packed = m_packed[index/2];
+    if (index & 1){
+        packed.imag(value);
+    } else {
+        packed.real(value);
     }
+}
+
+template < typename T >
+const vector< T > &BasicRealFFT< T >::computeFrequentialAmplitudes(){
+    computeEval();
+    m_halfSizeEngine.kernels().magnitudes(m_evalResults.data(), m_frequentialAmplitudes.data(), m_evalResults.size());
 
-    memcpy(&out[outOffset], &buffer[0], n*sizeof(Complex));
+    return m_frequentialAmplitudes;
 }
 
+// With z[k] = x[2k] + i * x[2k+1] and Z its transform of size m = n/2, the
+// transforms of the even and odd samples are :
+//   E[k] = (Z[k] + conj(Z[m-k])) / 2
+//   O[k] = (Z[k] - conj(Z[m-k])) / 2i
+// and the transform of x is X[k] = E[k] + omega^k * O[k].
+template < typename T >
+const vector< complex< T > > &BasicRealFFT< T >::computeEval(){
+    m_halfSizeEngine.eval(m_packed.data(), m_halfSizeResults.data(), false);
+    const vector< complex< T > > &z = m_halfSizeResults;
+    const size_t m = m_numberOfPoints/2;
 
+    for (size_t k=0; k<=m; k++){
+        const complex< T > zk = z[k == m ? 0 : k];
+        const complex< T > zmk = conj(z[k == 0 ? 0 : m-k]);
+        const complex< T > even = (zk + zmk) * (T)0.5;
+        const complex< T > odd = (zk - zmk) * complex< T >(0.0, -0.5);
+        m_evalResults[k] = even + m_twiddles[k] * odd;
+    }
+    return m_evalResults;
+}
 
+template class BasicRealFFT< double >;
+template class BasicRealFFT< float >;
@@ -4,6 +4,9 @@
 #include <vector>
 #include <complex>
 #include <utility>
+#include <memory>
+
+#include "fftkernels.hpp"
 
 using Complex = std::complex< double >;
 
@@ -24,29 +27,105 @@ public:
 };
 
 
+// Transform of any number of points, shared by the transforms below:
+//  - powers of two use an iterative radix-2 decimation in time, whose inner
+//    loops are delegated to the fastest kernels the CPU supports,
+//  - sizes made of the factors 2, 3, 4 and 5 (such as 441 or 480) use a
+//    recursive mixed radix decimation in time,
+//  - any other size is turned into a circular convolution (Bluestein's
+//    algorithm) computed with a power-of-two transform.
+// All the tables are computed once in the constructor so that the
+// evaluation itself does no transcendental math and no allocation.
+template < typename T >
+class FFTEngine {
+public:
+    explicit FFTEngine(size_t numberOfPoints, const FFTKernels< T > &kernels = getFFTKernels< T >());
+    size_t size() const { return m_numberOfPoints; }
+    const FFTKernels< T > &kernels() const { return *m_kernels; }
+
+    // out receives the size() evaluations of in, it must not overlap in.
+    void eval(const std::complex< T > *in, std::complex< T > *out, bool inverse);
+
+private:
+    enum Algorithm { radix2, mixedRadix, bluestein };
+
+    size_t m_numberOfPoints;
+    const FFTKernels< T > *m_kernels;
+    Algorithm m_algorithm;
+
+    // radix-2 : the powers of omega used by each stage, stored contiguously
+    // so that the kernels can load them as vectors : the stage combining
+    // blocks of 2*h points reads its h twiddles from offset h-1.
+    // mixed radix : omega^k for k in [0, n).
+    std::vector< std::complex< T > > m_twiddles;
+    std::vector< std::complex< T > > m_inverseTwiddles;
+
+    std::vector< size_t > m_bitReversal;   // radix-2 : input index read by each output slot
+    std::vector< size_t > m_factors;       // mixed radix : radices, outermost first
+
+    // Bluestein : the chirp b[k] = omega^(k*k/2) and the spectrum of its
+    // conjugate, zero-padded to the power-of-two size of the convolution.
+    std::vector< std::complex< T > > m_chirp;
+    std::vector< std::complex< T > > m_chirpSpectrum;
+    std::vector< std::complex< T > > m_inverseChirpSpectrum;
+    std::unique_ptr< FFTEngine< T > > m_convolutionEngine;
+    std::vector< std::complex< T > > m_convolutionInput;
+    std::vector< std::complex< T > > m_convolutionOutput;
+
+    void evalRadix2(const std::complex< T > *in, std::complex< T > *out, bool inverse);
+    void evalMixedRadix(const std::complex< T > *in, std::complex< T > *out, size_t inStride,
+                        size_t factorIndex, size_t n, const std::complex< T > *twiddles);
+    void evalBluestein(const std::complex< T > *in, std::complex< T > *out, bool inverse);
+};
+
+
 class FFT {
 public:
     explicit FFT(const ComplexPolynomial &p, size_t numberOfPoints);
     void setValue(size_t index, const Complex value);
     const std::vector<double> &computeFrequentialAmplitudes();
-    ComplexPolynomial computeEval();
-    ComplexPolynomial computeEvalInverse();
+    const ComplexPolynomial &computeEval();
+    const ComplexPolynomial &computeEvalInverse();
 
     static void displayComplexPolynomial(const ComplexPolynomial &p);
     static void displayComplexPolynomialAbs(const ComplexPolynomial &p);
 
 private:
-    size_t m_numberOfPoints;
-    Complex m_omega;
+    FFTEngine< double > m_engine;
+    double m_inverseScale;
     ComplexPolynomial m_coefs;
-    ComplexPolynomial m_buffer;
     ComplexPolynomial m_evalResults;
     std::vector<double> m_frequentialAmplitudes;
-
-    void fastEvalWithBuffer(size_t start, size_t step, Complex omega, size_t n, size_t outOffset, ComplexPolynomial &out, ComplexPolynomial &buffer);
 };
 
 
+// Transform of N real samples. The samples are packed two by two into a
+// complex FFT of N/2 points (even indices in the real part, odd indices in
+// the imaginary part) and the spectrum is then untangled from it.
+// Only the N/2+1 non-redundant bins are returned: for a real input the
+// other bins are the complex conjugates of these ones. N must be even, an
+// odd number of points is padded with one zero.
+// RealFFTFloat works directly on the paFloat32 samples of PortAudio.
+template < typename T >
+class BasicRealFFT {
+public:
+    explicit BasicRealFFT(const std::vector< T > &p, size_t numberOfPoints);
+    void setValue(size_t index, T value);
+    const std::vector< T > &computeFrequentialAmplitudes();
+    const std::vector< std::complex< T > > &computeEval();
+
+private:
+    size_t m_numberOfPoints;
+    FFTEngine< T > m_halfSizeEngine;
+    std::vector< std::complex< T > > m_packed;
+    std::vector< std::complex< T > > m_halfSizeResults;
+    std::vector< std::complex< T > > m_twiddles;    // omega^k for k in [0, n/2]
+    std::vector< std::complex< T > > m_evalResults;
+    std::vector< T > m_frequentialAmplitudes;
+};
+
+using RealFFT = BasicRealFFT< double >;
+using RealFFTFloat = BasicRealFFT< float >;
 
 
 #endif
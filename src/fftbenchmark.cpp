@@ -0,0 +1,67 @@
+#include "fftbenchmark.hpp"
+#include "fft.hpp"
+#include "fixedsizefft.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <stdlib.h>
+
+using namespace std;
+using namespace std::chrono;
+
+
+template < size_t N, typename T >
+void FFTBenchmark::compareRuntimeAndFixedSize(int iterations){
+    vector< complex< T > > in(N);
+    for (auto &c : in){
+        c = complex< T >(((rand() % 2000)-1000)/1000.0, ((rand() % 2000)-1000)/1000.0);
+    }
+
+    // Both sides do the same work : load the input, evaluate, take the
+    // magnitudes. The checksum keeps the compiler from skipping any of it.
+    double checksum = 0.0;
+
+    FFTEngine< T > engine(N);
+    vector< complex< T > > out(N);
+    vector< T > amplitudes(N);
+    high_resolution_clock::time_point t0 = high_resolution_clock::now();
+    for (int it=0; it<iterations; it++){
+        engine.eval(in.data(), out.data(), false);
+        engine.kernels().magnitudes(out.data(), amplitudes.data(), N);
+        checksum += amplitudes[it % N];
+    }
+    high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+    FixedSizeFFT< N, T > fixedSizeFFT;
+    for (size_t i=0; i<N; i++){
+        fixedSizeFFT.setValue(i, in[i]);
+    }
+    high_resolution_clock::time_point t2 = high_resolution_clock::now();
+    for (int it=0; it<iterations; it++){
+        checksum += fixedSizeFFT.computeFrequentialAmplitudes()[it % N];
+    }
+    high_resolution_clock::time_point t3 = high_resolution_clock::now();
+
+    duration<double, std::micro> runtimeSpan = t1 - t0;
+    duration<double, std::micro> fixedSizeSpan = t3 - t2;
+    cout << setw(5) << N << " points, " << sizeof(T)*8 << " bits : "
+         << "FFTEngine (" << engine.kernels().name << ") " << setw(8) << runtimeSpan.count()/iterations << " us"
+         << "   FixedSizeFFT " << setw(8) << fixedSizeSpan.count()/iterations << " us"
+         << "   (checksum " << checksum << ")" << endl;
+}
+
+void FFTBenchmark::run(){
+    srand(3);
+    cout << fixed << setprecision(3);
+
+    compareRuntimeAndFixedSize< 64, float >(100000);
+    compareRuntimeAndFixedSize< 256, float >(50000);
+    compareRuntimeAndFixedSize< 512, float >(20000);
+    compareRuntimeAndFixedSize< 1024, float >(10000);
+    compareRuntimeAndFixedSize< 64, double >(100000);
+    compareRuntimeAndFixedSize< 256, double >(50000);
+    compareRuntimeAndFixedSize< 512, double >(20000);
+    compareRuntimeAndFixedSize< 1024, double >(10000);
+}
@@ -0,0 +1,16 @@
+#ifndef FFT_BENCHMARK_HPP
+#define FFT_BENCHMARK_HPP
+
+#include <cstddef>
+
+
+class FFTBenchmark {
+public:
+    void run();
+private:
+    template < size_t N, typename T >
+    void compareRuntimeAndFixedSize(int iterations);
+};
+
+
+#endif
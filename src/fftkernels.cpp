@@ -0,0 +1,515 @@
+#include "fftkernels.hpp"
+
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FFT_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FFT_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+
+// ---------------------------------------------------------------------------
+// Scalar kernels, the reference for all the others.
+
+template < typename T >
+void scalarButterflyStage(complex< T > *data, size_t n, size_t half, const complex< T > *twiddles){
+    for (size_t start=0; start<n; start+=2*half){
+        complex< T > *even = data + start;
+        complex< T > *odd = even + half;
+        for (size_t i=0; i<half; i++){
+            const complex< T > t = complexMultiply(twiddles[i], odd[i]);
+            odd[i] = even[i] - t;
+            even[i] = even[i] + t;
+        }
+    }
+}
+
+template < typename T >
+void scalarMagnitudes(const complex< T > *in, T *out, size_t count){
+    for (size_t i=0; i<count; i++){
+        out[i] = sqrt(in[i].real()*in[i].real() + in[i].imag()*in[i].imag());
+    }
+}
+
+template < typename T >
+void scalarScale(complex< T > *data, T factor, size_t count){
+    T *values = reinterpret_cast< T * >(data);
+    for (size_t i=0; i<2*count; i++){
+        values[i] *= factor;
+    }
+}
+
+template < typename T >
+const FFTKernels< T > scalarKernels = {
+    "scalar",
+    scalarButterflyStage< T >,
+    scalarMagnitudes< T >,
+    scalarScale< T >
+};
+
+
+#ifdef FFT_KERNELS_X86
+// ---------------------------------------------------------------------------
+// SSE2 : one complex double or two complex floats per register.
+// The products use the (re, im) * (wr, wi) trick :
+//   (wr, wr) * (re, im) + (-wi, wi) * (im, re)
+
+__attribute__((target("sse2")))
+inline __m128d sse2Multiply(__m128d w, __m128d b){
+    const __m128d signMask = _mm_set_pd(0.0, -0.0);
+    const __m128d wr = _mm_unpacklo_pd(w, w);
+    const __m128d wi = _mm_xor_pd(_mm_unpackhi_pd(w, w), signMask);
+    const __m128d bSwapped = _mm_shuffle_pd(b, b, 1);
+    return _mm_add_pd(_mm_mul_pd(wr, b), _mm_mul_pd(wi, bSwapped));
+}
+
+__attribute__((target("sse2")))
+inline __m128 sse2Multiply(__m128 w, __m128 b){
+    const __m128 signMask = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    const __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+    const __m128 wi = _mm_xor_ps(_mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1)), signMask);
+    const __m128 bSwapped = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_add_ps(_mm_mul_ps(wr, b), _mm_mul_ps(wi, bSwapped));
+}
+
+__attribute__((target("sse2")))
+void sse2ButterflyStageDouble(complex< double > *data, size_t n, size_t half, const complex< double > *twiddles){
+    double *values = reinterpret_cast< double * >(data);
+    const double *w = reinterpret_cast< const double * >(twiddles);
+
+    for (size_t start=0; start<n; start+=2*half){
+        double *even = values + 2*start;
+        double *odd = even + 2*half;
+        for (size_t i=0; i<2*half; i+=2){
+            const __m128d a = _mm_loadu_pd(even + i);
+            const __m128d t = sse2Multiply(_mm_loadu_pd(w + i), _mm_loadu_pd(odd + i));
+            _mm_storeu_pd(odd + i, _mm_sub_pd(a, t));
+            _mm_storeu_pd(even + i, _mm_add_pd(a, t));
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+void sse2ButterflyStageFloat(complex< float > *data, size_t n, size_t half, const complex< float > *twiddles){
+    if (half < 2){
+        scalarButterflyStage(data, n, half, twiddles);
+        return;
+    }
+    float *values = reinterpret_cast< float * >(data);
+    const float *w = reinterpret_cast< const float * >(twiddles);
+
+    for (size_t start=0; start<n; start+=2*half){
+        float *even = values + 2*start;
+        float *odd = even + 2*half;
+        for (size_t i=0; i<2*half; i+=4){
+            const __m128 a = _mm_loadu_ps(even + i);
+            const __m128 t = sse2Multiply(_mm_loadu_ps(w + i), _mm_loadu_ps(odd + i));
+            _mm_storeu_ps(odd + i, _mm_sub_ps(a, t));
+            _mm_storeu_ps(even + i, _mm_add_ps(a, t));
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+void sse2MagnitudesDouble(const complex< double > *in, double *out, size_t count){
+    const double *values = reinterpret_cast< const double * >(in);
+    size_t i = 0;
+    for (; i+2<=count; i+=2){
+        const __m128d a = _mm_loadu_pd(values + 2*i);
+        const __m128d b = _mm_loadu_pd(values + 2*i + 2);
+        const __m128d a2 = _mm_mul_pd(a, a);
+        const __m128d b2 = _mm_mul_pd(b, b);
+        const __m128d sum = _mm_add_pd(_mm_unpacklo_pd(a2, b2), _mm_unpackhi_pd(a2, b2));
+        _mm_storeu_pd(out + i, _mm_sqrt_pd(sum));
+    }
+    scalarMagnitudes(in + i, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void sse2MagnitudesFloat(const complex< float > *in, float *out, size_t count){
+    const float *values = reinterpret_cast< const float * >(in);
+    size_t i = 0;
+    for (; i+4<=count; i+=4){
+        const __m128 a = _mm_loadu_ps(values + 2*i);
+        const __m128 b = _mm_loadu_ps(values + 2*i + 4);
+        const __m128 a2 = _mm_mul_ps(a, a);
+        const __m128 b2 = _mm_mul_ps(b, b);
+        const __m128 re2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 im2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out + i, _mm_sqrt_ps(_mm_add_ps(re2, im2)));
+    }
+    scalarMagnitudes(in + i, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+void sse2ScaleDouble(complex< double > *data, double factor, size_t count){
+    double *values = reinterpret_cast< double * >(data);
+    const __m128d f = _mm_set1_pd(factor);
+    for (size_t i=0; i<2*count; i+=2){
+        _mm_storeu_pd(values + i, _mm_mul_pd(_mm_loadu_pd(values + i), f));
+    }
+}
+
+__attribute__((target("sse2")))
+void sse2ScaleFloat(complex< float > *data, float factor, size_t count){
+    float *values = reinterpret_cast< float * >(data);
+    const __m128 f = _mm_set1_ps(factor);
+    size_t i = 0;
+    for (; i+4<=2*count; i+=4){
+        _mm_storeu_ps(values + i, _mm_mul_ps(_mm_loadu_ps(values + i), f));
+    }
+    scalarScale(data + i/2, factor, count - i/2);
+}
+
+const FFTKernels< double > sse2KernelsDouble = {
+    "sse2",
+    sse2ButterflyStageDouble,
+    sse2MagnitudesDouble,
+    sse2ScaleDouble
+};
+
+const FFTKernels< float > sse2KernelsFloat = {
+    "sse2",
+    sse2ButterflyStageFloat,
+    sse2MagnitudesFloat,
+    sse2ScaleFloat
+};
+
+
+// ---------------------------------------------------------------------------
+// AVX2 : two complex doubles or four complex floats per register.
+// The products use addsub : (wr * b) -/+ (wi * swapped b).
+
+__attribute__((target("avx2")))
+inline __m256d avx2Multiply(__m256d w, __m256d b){
+    const __m256d wr = _mm256_movedup_pd(w);
+    const __m256d wi = _mm256_permute_pd(w, 0xF);
+    const __m256d bSwapped = _mm256_permute_pd(b, 0x5);
+    return _mm256_addsub_pd(_mm256_mul_pd(wr, b), _mm256_mul_pd(wi, bSwapped));
+}
+
+__attribute__((target("avx2")))
+inline __m256 avx2Multiply(__m256 w, __m256 b){
+    const __m256 wr = _mm256_moveldup_ps(w);
+    const __m256 wi = _mm256_movehdup_ps(w);
+    const __m256 bSwapped = _mm256_permute_ps(b, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_addsub_ps(_mm256_mul_ps(wr, b), _mm256_mul_ps(wi, bSwapped));
+}
+
+__attribute__((target("avx2")))
+void avx2ButterflyStageDouble(complex< double > *data, size_t n, size_t half, const complex< double > *twiddles){
+    if (half < 2){
+        sse2ButterflyStageDouble(data, n, half, twiddles);
+        return;
+    }
+    double *values = reinterpret_cast< double * >(data);
+    const double *w = reinterpret_cast< const double * >(twiddles);
+
+    for (size_t start=0; start<n; start+=2*half){
+        double *even = values + 2*start;
+        double *odd = even + 2*half;
+        for (size_t i=0; i<2*half; i+=4){
+            const __m256d a = _mm256_loadu_pd(even + i);
+            const __m256d t = avx2Multiply(_mm256_loadu_pd(w + i), _mm256_loadu_pd(odd + i));
+            _mm256_storeu_pd(odd + i, _mm256_sub_pd(a, t));
+            _mm256_storeu_pd(even + i, _mm256_add_pd(a, t));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+void avx2ButterflyStageFloat(complex< float > *data, size_t n, size_t half, const complex< float > *twiddles){
+    if (half < 4){
+        sse2ButterflyStageFloat(data, n, half, twiddles);
+        return;
+    }
+    float *values = reinterpret_cast< float * >(data);
+    const float *w = reinterpret_cast< const float * >(twiddles);
+
+    for (size_t start=0; start<n; start+=2*half){
+        float *even = values + 2*start;
+        float *odd = even + 2*half;
+        for (size_t i=0; i<2*half; i+=8){
+            const __m256 a = _mm256_loadu_ps(even + i);
+            const __m256 t = avx2Multiply(_mm256_loadu_ps(w + i), _mm256_loadu_ps(odd + i));
+            _mm256_storeu_ps(odd + i, _mm256_sub_ps(a, t));
+            _mm256_storeu_ps(even + i, _mm256_add_ps(a, t));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+void avx2MagnitudesDouble(const complex< double > *in, double *out, size_t count){
+    const double *values = reinterpret_cast< const double * >(in);
+    size_t i = 0;
+    for (; i+4<=count; i+=4){
+        const __m256d a = _mm256_loadu_pd(values + 2*i);
+        const __m256d b = _mm256_loadu_pd(values + 2*i + 4);
+        // hadd gives the bins in the order 0, 2, 1, 3
+        const __m256d sum = _mm256_hadd_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b));
+        const __m256d ordered = _mm256_permute4x64_pd(sum, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_pd(out + i, _mm256_sqrt_pd(ordered));
+    }
+    sse2MagnitudesDouble(in + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void avx2MagnitudesFloat(const complex< float > *in, float *out, size_t count){
+    const float *values = reinterpret_cast< const float * >(in);
+    size_t i = 0;
+    for (; i+8<=count; i+=8){
+        const __m256 a = _mm256_loadu_ps(values + 2*i);
+        const __m256 b = _mm256_loadu_ps(values + 2*i + 8);
+        const __m256 a2 = _mm256_mul_ps(a, a);
+        const __m256 b2 = _mm256_mul_ps(b, b);
+        // the shuffles work per 128 bits lane and give the bins in the
+        // order 0 1 4 5 2 3 6 7, put back in order by moving 64 bits blocks
+        const __m256 re2 = _mm256_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 im2 = _mm256_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m256d sum = _mm256_castps_pd(_mm256_add_ps(re2, im2));
+        const __m256 ordered = _mm256_castpd_ps(_mm256_permute4x64_pd(sum, _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(out + i, _mm256_sqrt_ps(ordered));
+    }
+    sse2MagnitudesFloat(in + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void avx2ScaleDouble(complex< double > *data, double factor, size_t count){
+    double *values = reinterpret_cast< double * >(data);
+    const __m256d f = _mm256_set1_pd(factor);
+    size_t i = 0;
+    for (; i+4<=2*count; i+=4){
+        _mm256_storeu_pd(values + i, _mm256_mul_pd(_mm256_loadu_pd(values + i), f));
+    }
+    sse2ScaleDouble(data + i/2, factor, count - i/2);
+}
+
+__attribute__((target("avx2")))
+void avx2ScaleFloat(complex< float > *data, float factor, size_t count){
+    float *values = reinterpret_cast< float * >(data);
+    const __m256 f = _mm256_set1_ps(factor);
+    size_t i = 0;
+    for (; i+8<=2*count; i+=8){
+        _mm256_storeu_ps(values + i, _mm256_mul_ps(_mm256_loadu_ps(values + i), f));
+    }
+    sse2ScaleFloat(data + i/2, factor, count - i/2);
+}
+
+const FFTKernels< double > avx2KernelsDouble = {
+    "avx2",
+    avx2ButterflyStageDouble,
+    avx2MagnitudesDouble,
+    avx2ScaleDouble
+};
+
+const FFTKernels< float > avx2KernelsFloat = {
+    "avx2",
+    avx2ButterflyStageFloat,
+    avx2MagnitudesFloat,
+    avx2ScaleFloat
+};
+#endif
+
+
+#ifdef FFT_KERNELS_NEON
+// ---------------------------------------------------------------------------
+// NEON : the structure loads split the real and imaginary parts into two
+// registers, so the products need no shuffle at all.
+// Four complex floats per register pair; two complex doubles on AArch64.
+
+void neonButterflyStageFloat(complex< float > *data, size_t n, size_t half, const complex< float > *twiddles){
+    if (half < 4){
+        scalarButterflyStage(data, n, half, twiddles);
+        return;
+    }
+    float *values = reinterpret_cast< float * >(data);
+    const float *w = reinterpret_cast< const float * >(twiddles);
+
+    for (size_t start=0; start<n; start+=2*half){
+        float *even = values + 2*start;
+        float *odd = even + 2*half;
+        for (size_t i=0; i<2*half; i+=8){
+            const float32x4x2_t a = vld2q_f32(even + i);
+            const float32x4x2_t b = vld2q_f32(odd + i);
+            const float32x4x2_t wv = vld2q_f32(w + i);
+            const float32x4_t tr = vmlsq_f32(vmulq_f32(wv.val[0], b.val[0]), wv.val[1], b.val[1]);
+            const float32x4_t ti = vmlaq_f32(vmulq_f32(wv.val[0], b.val[1]), wv.val[1], b.val[0]);
+            float32x4x2_t result;
+            result.val[0] = vsubq_f32(a.val[0], tr);
+            result.val[1] = vsubq_f32(a.val[1], ti);
+            vst2q_f32(odd + i, result);
+            result.val[0] = vaddq_f32(a.val[0], tr);
+            result.val[1] = vaddq_f32(a.val[1], ti);
+            vst2q_f32(even + i, result);
+        }
+    }
+}
+
+void neonMagnitudesFloat(const complex< float > *in, float *out, size_t count){
+    const float *values = reinterpret_cast< const float * >(in);
+    size_t i = 0;
+    for (; i+4<=count; i+=4){
+        const float32x4x2_t c = vld2q_f32(values + 2*i);
+        const float32x4_t sum = vmlaq_f32(vmulq_f32(c.val[0], c.val[0]), c.val[1], c.val[1]);
+#ifdef __aarch64__
+        vst1q_f32(out + i, vsqrtq_f32(sum));
+#else
+        // ARMv7 NEON has no vector square root
+        vst1q_f32(out + i, sum);
+        for (size_t j=i; j<i+4; j++){
+            out[j] = sqrt(out[j]);
+        }
+#endif
+    }
+    scalarMagnitudes(in + i, out + i, count - i);
+}
+
+void neonScaleFloat(complex< float > *data, float factor, size_t count){
+    float *values = reinterpret_cast< float * >(data);
+    size_t i = 0;
+    for (; i+4<=2*count; i+=4){
+        vst1q_f32(values + i, vmulq_n_f32(vld1q_f32(values + i), factor));
+    }
+    scalarScale(data + i/2, factor, count - i/2);
+}
+
+const FFTKernels< float > neonKernelsFloat = {
+    "neon",
+    neonButterflyStageFloat,
+    neonMagnitudesFloat,
+    neonScaleFloat
+};
+
+#ifdef __aarch64__
+void neonButterflyStageDouble(complex< double > *data, size_t n, size_t half, const complex< double > *twiddles){
+    if (half < 2){
+        scalarButterflyStage(data, n, half, twiddles);
+        return;
+    }
+    double *values = reinterpret_cast< double * >(data);
+    const double *w = reinterpret_cast< const double * >(twiddles);
+
+    for (size_t start=0; start<n; start+=2*half){
+        double *even = values + 2*start;
+        double *odd = even + 2*half;
+        for (size_t i=0; i<2*half; i+=4){
+            const float64x2x2_t a = vld2q_f64(even + i);
+            const float64x2x2_t b = vld2q_f64(odd + i);
+            const float64x2x2_t wv = vld2q_f64(w + i);
+            const float64x2_t tr = vmlsq_f64(vmulq_f64(wv.val[0], b.val[0]), wv.val[1], b.val[1]);
+            const float64x2_t ti = vmlaq_f64(vmulq_f64(wv.val[0], b.val[1]), wv.val[1], b.val[0]);
+            float64x2x2_t result;
+            result.val[0] = vsubq_f64(a.val[0], tr);
+            result.val[1] = vsubq_f64(a.val[1], ti);
+            vst2q_f64(odd + i, result);
+            result.val[0] = vaddq_f64(a.val[0], tr);
+            result.val[1] = vaddq_f64(a.val[1], ti);
+            vst2q_f64(even + i, result);
+        }
+    }
+}
+
+void neonMagnitudesDouble(const complex< double > *in, double *out, size_t count){
+    const double *values = reinterpret_cast< const double * >(in);
+    size_t i = 0;
+    for (; i+2<=count; i+=2){
+        const float64x2x2_t c = vld2q_f64(values + 2*i);
+        const float64x2_t sum = vmlaq_f64(vmulq_f64(c.val[0], c.val[0]), c.val[1], c.val[1]);
+        vst1q_f64(out + i, vsqrtq_f64(sum));
+    }
+    scalarMagnitudes(in + i, out + i, count - i);
+}
+
+void neonScaleDouble(complex< double > *data, double factor, size_t count){
+    double *values = reinterpret_cast< double * >(data);
+    for (size_t i=0; i<2*count; i+=2){
+        vst1q_f64(values + i, vmulq_n_f64(vld1q_f64(values + i), factor));
+    }
+}
+
+const FFTKernels< double > neonKernelsDouble = {
+    "neon",
+    neonButterflyStageDouble,
+    neonMagnitudesDouble,
+    neonScaleDouble
+};
+#endif
+#endif
+
+
+// ---------------------------------------------------------------------------
+// Dispatch. On x86 the instruction sets are detected at runtime, so one
+// binary runs everywhere. NEON is a compile time choice: on 32 bits ARM the
+// compiler only accepts the intrinsics when building with -mfpu=neon, and
+// then it is free to use NEON anywhere in the program anyway.
+
+template < typename T >
+vector< const FFTKernels< T > * > detectFFTKernels(const FFTKernels< T > *avx2,
+                                                   const FFTKernels< T > *sse2,
+                                                   const FFTKernels< T > *neon){
+    vector< const FFTKernels< T > * > kernels;
+#ifdef FFT_KERNELS_X86
+    __builtin_cpu_init();
+    if (avx2 && __builtin_cpu_supports("avx2")){
+        kernels.push_back(avx2);
+    }
+    if (sse2 && __builtin_cpu_supports("sse2")){
+        kernels.push_back(sse2);
+    }
+#endif
+    if (neon){
+        kernels.push_back(neon);
+    }
+    kernels.push_back(&scalarKernels< T >);
+    return kernels;
+}
+
+template <>
+const vector< const FFTKernels< double > * > &getAvailableFFTKernels< double >(){
+    static const vector< const FFTKernels< double > * > kernels = detectFFTKernels< double >(
+#ifdef FFT_KERNELS_X86
+        &avx2KernelsDouble, &sse2KernelsDouble,
+#else
+        nullptr, nullptr,
+#endif
+#if defined(FFT_KERNELS_NEON) && defined(__aarch64__)
+        &neonKernelsDouble
+#else
+        nullptr
+#endif
+    );
+    return kernels;
+}
+
+template <>
+const vector< const FFTKernels< float > * > &getAvailableFFTKernels< float >(){
+    static const vector< const FFTKernels< float > * > kernels = detectFFTKernels< float >(
+#ifdef FFT_KERNELS_X86
+        &avx2KernelsFloat, &sse2KernelsFloat,
+#else
+        nullptr, nullptr,
+#endif
+#ifdef FFT_KERNELS_NEON
+        &neonKernelsFloat
+#else
+        nullptr
+#endif
+    );
+    return kernels;
+}
+
+template < typename T >
+const FFTKernels< T > &getFFTKernels(){
+    static const FFTKernels< T > &kernels = *getAvailableFFTKernels< T >().front();
+    return kernels;
+}
+
+template const FFTKernels< double > &getFFTKernels< double >();
+template const FFTKernels< float > &getFFTKernels< float >();
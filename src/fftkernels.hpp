@@ -0,0 +1,48 @@
+#ifndef FFT_KERNELS_HPP
+#define FFT_KERNELS_HPP
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+
+// The inner loops of the FFT, in one flavour per instruction set.
+// All of them work on the interleaved (real, imaginary) layout of
+// std::complex, so the buffers can be handed over without conversion.
+template < typename T >
+struct FFTKernels {
+    const char *name;
+
+    // One radix-2 stage over the n points of data, made of blocks of
+    // 2*half points. For each block and each i < half :
+    //   t = twiddles[i] * data[i + half]
+    //   data[i + half] = data[i] - t
+    //   data[i] = data[i] + t
+    void (*butterflyStage)(std::complex< T > *data, size_t n, size_t half, const std::complex< T > *twiddles);
+
+    // out[i] = |in[i]|
+    void (*magnitudes)(const std::complex< T > *in, T *out, size_t count);
+
+    // data[i] *= factor
+    void (*scale)(std::complex< T > *data, T factor, size_t count);
+};
+
+// Complex product written by hand: operator* of std::complex goes through
+// a NaN-checking library call unless the whole program is built with
+// -ffast-math.
+template < typename T >
+inline std::complex< T > complexMultiply(const std::complex< T > &a, const std::complex< T > &b){
+    return std::complex< T >(a.real()*b.real() - a.imag()*b.imag(),
+                             a.real()*b.imag() + a.imag()*b.real());
+}
+
+// Kernels supported by the running CPU, the fastest first.
+// The scalar kernels are always available and always last.
+template < typename T >
+const std::vector< const FFTKernels< T > * > &getAvailableFFTKernels();
+
+// The fastest kernels, detected once at startup.
+template < typename T >
+const FFTKernels< T > &getFFTKernels();
+
+#endif
@@ -1,4 +1,10 @@
 #include "ffttester.hpp"
+#include "fixedsizefft.hpp"
+#include "stft.hpp"
+#include "deinterleave.hpp"
+#include "slidingdft.hpp"
+#include "levelmeter.hpp"
+#include "workstealingpool.hpp"
 
 #include <iostream>
 #include <algorithm>
@@ -6,6 +12,8 @@
 #include <numeric>
 #include <random>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <iomanip>
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -30,6 +38,448 @@ void FFTTester::testPolynomialsProduct(const Polynomial &p1, const Polynomial &p
     cout << "Test OK: 2 polynomials of size : " << p1.size() << " and " << p2.size() << endl;
 }
 
+void FFTTester::testRealTransform(const Polynomial &p){
+    ComplexPolynomial complexEval = FFT(ComplexPolynomial(p), p.size()).computeEval();
+    vector< Complex > realEval = RealFFT(p, p.size()).computeEval();
+    vector< complex< float > > realFloatEval = RealFFTFloat(vector< float >(p.begin(), p.end()), p.size()).computeEval();
+
+    // float32 keeps about 7 significant digits of the largest bins
+    double floatTolerance = 0.0;
+    for (const auto &c : complexEval){
+        floatTolerance = max(floatTolerance, abs(c) * 0.00001);
+    }
+
+    for (size_t i=0; i<realEval.size(); i++){
+        if (abs(realEval[i] - complexEval[i]) > 0.00001){
+            cout << "Different ! " << realEval[i] << " vs " << complexEval[i] << endl;
+            throw WrongRealTransformException();
+        }
+        if (abs(Complex(realFloatEval[i]) - complexEval[i]) > floatTolerance){
+            cout << "Different ! " << realFloatEval[i] << " vs " << complexEval[i] << endl;
+            throw WrongRealTransformException();
+        }
+    }
+
+    cout << "Test OK: real transform of size : " << p.size() << endl;
+}
+
+void FFTTester::testArbitrarySizeTransform(size_t size){
+    static const double pi = std::acos(-1);
+    ComplexPolynomial p(size);
+    for (auto &c : p){
+        c = Complex(((rand() % 2000)-1000)/10.0, ((rand() % 2000)-1000)/10.0);
+    }
+
+    ComplexPolynomial eval = FFT(p, size).computeEval();
+    ComplexPolynomial inverse = FFT(eval, size).computeEvalInverse();
+
+    for (size_t k=0; k<size; k++){
+        Complex expected = 0.0;
+        for (size_t j=0; j<size; j++){
+            expected += p[j] * polar(1.0, 2.0 * pi * (double)((j*k) % size) / (double)size);
+        }
+        if (abs(eval[k] - expected) > 0.0001 || abs(inverse[k] - p[k]) > 0.0001){
+            cout << "Different ! " << eval[k] << " vs " << expected << endl;
+            throw WrongArbitrarySizeTransformException();
+        }
+    }
+
+    cout << "Test OK: transform of size : " << size << endl;
+}
+
+template < typename T >
+void FFTTester::testKernels(){
+    const size_t size = 1024;
+    const size_t count = size - 3;     // also exercise the scalar tails
+    vector< complex< T > > in(size);
+    for (auto &c : in){
+        c = complex< T >(((rand() % 2000)-1000)/10.0, ((rand() % 2000)-1000)/10.0);
+    }
+
+    const FFTKernels< T > &scalarKernels = *getAvailableFFTKernels< T >().back();
+    vector< complex< T > > expected(size);
+    vector< T > expectedMagnitudes(size);
+    FFTEngine< T >(size, scalarKernels).eval(in.data(), expected.data(), false);
+    scalarKernels.magnitudes(expected.data(), expectedMagnitudes.data(), count);
+    scalarKernels.scale(expected.data(), (T)0.5, count);
+
+    for (const FFTKernels< T > *kernels : getAvailableFFTKernels< T >()){
+        vector< complex< T > > out(size);
+        vector< T > magnitudes(size);
+        FFTEngine< T >(size, *kernels).eval(in.data(), out.data(), false);
+        kernels->magnitudes(out.data(), magnitudes.data(), count);
+        kernels->scale(out.data(), (T)0.5, count);
+
+        for (size_t i=0; i<size; i++){
+            const double tolerance = 0.0001 * (1.0 + abs(expectedMagnitudes[i]));
+            if (abs(out[i] - expected[i]) > tolerance ||
+                abs(magnitudes[i] - expectedMagnitudes[i]) > tolerance){
+                cout << "Different ! " << kernels->name << " " << out[i] << " vs " << expected[i] << endl;
+                throw WrongKernelException();
+            }
+        }
+        cout << "Test OK: " << kernels->name << " kernels with " << sizeof(T)*8 << " bits values" << endl;
+    }
+}
+
+template < size_t N, typename T >
+void FFTTester::testFixedSizeTransform(){
+    ComplexPolynomial p(N);
+    FixedSizeFFT< N, T > fixedSizeFFT;
+    for (size_t i=0; i<N; i++){
+        p[i] = Complex(((rand() % 2000)-1000)/10.0, ((rand() % 2000)-1000)/10.0);
+        fixedSizeFFT.setValue(i, complex< T >(p[i]));
+    }
+
+    ComplexPolynomial expected = FFT(p, N).computeEval();
+    const auto &eval = fixedSizeFFT.computeEval();
+    const double tolerance = (sizeof(T) == sizeof(float) ? 0.00001 : 0.000000001) * 100.0 * N;
+
+    for (size_t i=0; i<N; i++){
+        if (abs(Complex(eval[i]) - expected[i]) > tolerance){
+            cout << "Different ! " << eval[i] << " vs " << expected[i] << endl;
+            throw WrongFixedSizeTransformException();
+        }
+    }
+
+    const auto &inverse = fixedSizeFFT.computeEvalInverse();
+    ComplexPolynomial expectedInverse = FFT(p, N).computeEvalInverse();
+    for (size_t i=0; i<N; i++){
+        if (abs(Complex(inverse[i]) - expectedInverse[i]) > tolerance){
+            cout << "Different ! " << inverse[i] << " vs " << expectedInverse[i] << endl;
+            throw WrongFixedSizeTransformException();
+        }
+    }
+
+    cout << "Test OK: fixed size transform of size : " << N << " with " << sizeof(T)*8 << " bits values" << endl;
+}
+
+void FFTTester::testSTFT(WindowType windowType){
+    const size_t frameSize = 512;
+    const size_t hopSize = frameSize / 4;
+    const size_t bin = 10;
+    STFT stft(frameSize, hopSize, windowType);
+
+    int numberOfFrames = 0;
+    for (size_t i=0; i<2*frameSize; i++){
+        if (stft.addSample((float)sin(2.0 * M_PI * (double)(bin * i) / (double)frameSize))){
+            numberOfFrames++;
+            if (i < frameSize){
+                continue;
+            }
+            // once the ring is full, the windowed sine shows up with the
+            // amplitude of the rectangular window and nothing leaks far away
+            const vector< float > &amplitudes = stft.computeFrequentialAmplitudes();
+            if (abs(amplitudes[bin] - frameSize/2.0) > frameSize/2.0 * 0.01 ||
+                amplitudes[3*bin] > frameSize/2.0 * 0.001){
+                cout << "Different ! " << amplitudes[bin] << " vs " << frameSize/2.0 << endl;
+                throw WrongSTFTException();
+            }
+        }
+    }
+    if (numberOfFrames != (int)(2*frameSize/hopSize)){
+        throw WrongSTFTException();
+    }
+
+    cout << "Test OK: STFT with window " << (int)windowType << endl;
+}
+
+void FFTTester::testSTFTHopSize(){
+    for (size_t hopSize : {(size_t)0, (size_t)513}){
+        try {
+            STFT stft(512, hopSize, WindowType::hann);
+        } catch (const STFT::InvalidHopSizeException &){
+            continue;
+        }
+        throw WrongSTFTException();
+    }
+    STFT stft(512, 512, WindowType::hann);
+
+    cout << "Test OK: STFT hop size checks" << endl;
+}
+
+void FFTTester::testStereoSTFT(){
+    const size_t frameSize = 512;
+    const size_t hopSize = frameSize / 4;
+    STFT stereo(frameSize, hopSize, WindowType::hann, 2);
+    STFT left(frameSize, hopSize, WindowType::hann);
+    STFT right(frameSize, hopSize, WindowType::hann);
+    STFT mid(frameSize, hopSize, WindowType::hann);
+    STFT side(frameSize, hopSize, WindowType::hann);
+
+    for (size_t i=0; i<2*frameSize; i++){
+        const float frame[2] = {
+            (float)sin(2.0 * M_PI * (double)(10 * i) / (double)frameSize),
+            (float)(0.5 * sin(2.0 * M_PI * (double)(37 * i) / (double)frameSize) + ((rand() % 2000)-1000)/10000.0)
+        };
+        left.addSample(frame[0]);
+        right.addSample(frame[1]);
+        mid.addSample((frame[0] + frame[1]) / 2);
+        side.addSample((frame[0] - frame[1]) / 2);
+        if (!stereo.addFrame(frame)){
+            continue;
+        }
+
+        // both channels come out of a single complex FFT, they must match
+        // the spectra computed one channel at a time
+        const SpectrumFrame &spectra = stereo.computeSpectra();
+        const vector< float > *channels[4] = { &spectra.channels[0], &spectra.channels[1], &spectra.mid, &spectra.side };
+        STFT *references[4] = { &left, &right, &mid, &side };
+        for (int c=0; c<4; c++){
+            const vector< float > &expected = references[c]->computeFrequentialAmplitudes();
+            if (channels[c]->size() != expected.size()){
+                throw WrongStereoSTFTException();
+            }
+            for (size_t k=0; k<expected.size(); k++){
+                if (abs((*channels[c])[k] - expected[k]) > 0.01){
+                    cout << "Different ! " << (*channels[c])[k] << " vs " << expected[k] << endl;
+                    throw WrongStereoSTFTException();
+                }
+            }
+        }
+    }
+
+    cout << "Test OK: stereo STFT" << endl;
+}
+
+void FFTTester::testMultichannelSTFT(size_t numberOfChannels){
+    const size_t frameSize = 512;
+    const size_t hopSize = frameSize / 4;
+    const size_t numberOfFrames = 2*frameSize + 3;
+    STFT multichannel(frameSize, hopSize, WindowType::hann, numberOfChannels);
+    vector< unique_ptr< STFT > > references;
+    for (size_t channel=0; channel<numberOfChannels; channel++){
+        references.emplace_back(new STFT(frameSize, hopSize, WindowType::hann));
+    }
+
+    vector< float > interleaved(numberOfFrames * numberOfChannels);
+    for (auto &sample : interleaved){
+        sample = (float)(((rand() % 2000)-1000)/1000.0);
+    }
+    vector< vector< float > > planar(numberOfChannels, vector< float >(hopSize));
+    vector< float * > planarPointers;
+    for (auto &buffer : planar){
+        planarPointers.push_back(buffer.data());
+    }
+
+    // blocks of any length, cut at the hops, as the Analyzer does
+    size_t frame = 0;
+    while (frame < numberOfFrames){
+        const size_t blockFrames = min({ multichannel.getFramesUntilHop(), numberOfFrames - frame,
+                                         (size_t)(1 + rand() % 50) });
+        const float *block = &interleaved[frame * numberOfChannels];
+        deinterleave(block, blockFrames, numberOfChannels, planarPointers.data());
+        for (size_t i=0; i<blockFrames; i++){
+            for (size_t channel=0; channel<numberOfChannels; channel++){
+                if (planar[channel][i] != block[i * numberOfChannels + channel]){
+                    throw WrongMultichannelSTFTException();
+                }
+                references[channel]->addSample(block[i * numberOfChannels + channel]);
+            }
+        }
+        frame += blockFrames;
+        if (!multichannel.addFrames(planarPointers.data(), blockFrames)){
+            continue;
+        }
+
+        // the channels come out of complex FFTs two by two, and of a real
+        // one for an odd last channel : they must match the spectra
+        // computed one channel at a time
+        const SpectrumFrame &spectra = multichannel.computeSpectra();
+        for (size_t channel=0; channel<numberOfChannels; channel++){
+            const vector< float > &expected = references[channel]->computeFrequentialAmplitudes();
+            for (size_t k=0; k<expected.size(); k++){
+                if (abs(spectra.channels[channel][k] - expected[k]) > 0.01){
+                    cout << "Different ! " << spectra.channels[channel][k] << " vs " << expected[k] << endl;
+                    throw WrongMultichannelSTFTException();
+                }
+            }
+        }
+    }
+
+    cout << "Test OK: STFT of " << numberOfChannels << " channels" << endl;
+}
+
+void FFTTester::testSlidingDFT(){
+    const size_t windowSize = 480;
+    const vector< size_t > bins = { 0, 1, 7, 120, 240 };
+    SlidingDFT slidingDFT(windowSize, bins);
+    SlidingDFT blockSlidingDFT(windowSize, bins);
+    Polynomial samples(10*windowSize + 17);
+    vector< float > block(samples.size());
+
+    for (size_t i=0; i<samples.size(); i++){
+        samples[i] = (float)(((rand() % 2000)-1000)/1000.0);
+        block[i] = (float)samples[i];
+        slidingDFT.addSample(block[i]);
+    }
+    blockSlidingDFT.addSamples(block.data(), block.size());
+
+    Polynomial latestWindow(samples.end() - windowSize, samples.end());
+    const vector< double > expected = RealFFT(latestWindow, windowSize).computeFrequentialAmplitudes();
+    const vector< float > &amplitudes = slidingDFT.computeFrequentialAmplitudes();
+
+    for (size_t i=0; i<bins.size(); i++){
+        if (abs(amplitudes[i] - expected[bins[i]]) > 0.001){
+            cout << "Different ! " << amplitudes[i] << " vs " << expected[bins[i]] << endl;
+            throw WrongSlidingDFTException();
+        }
+    }
+
+    // the same samples given by block, and the peaks they reached on the way
+    const vector< float > blockAmplitudes = blockSlidingDFT.computeFrequentialAmplitudes();
+    const vector< float > &peaks = blockSlidingDFT.computePeakAmplitudes();
+    for (size_t i=0; i<bins.size(); i++){
+        if (abs(blockAmplitudes[i] - expected[bins[i]]) > 0.001 || peaks[i] < blockAmplitudes[i]){
+            cout << "Different ! " << blockAmplitudes[i] << " or " << peaks[i] << " vs " << expected[bins[i]] << endl;
+            throw WrongSlidingDFTException();
+        }
+    }
+    // the peaks start over after each call
+    for (float amplitude : blockSlidingDFT.computePeakAmplitudes()){
+        if (amplitude != 0.0f){
+            throw WrongSlidingDFTException();
+        }
+    }
+
+    cout << "Test OK: sliding DFT over " << samples.size() << " samples" << endl;
+}
+
+void FFTTester::testScope(){
+    // 10 samples per column, and 10 columns more than the waveform holds
+    Scope scope(32000, 0.1, 0.2);
+    const size_t samplesPerColumn = scope.getSamplesPerColumn();
+    const size_t numberOfColumns = ScopeFrame::NUMBER_OF_COLUMNS + 10;
+    vector< float > samples(numberOfColumns * samplesPerColumn * 2);
+
+    for (size_t i=0; i<samples.size()/2; i++){
+        samples[2*i] = (float)(((rand() % 2000)-1000)/1000.0);
+        samples[2*i+1] = -samples[2*i];
+        scope.addFrame(&samples[2*i], 2);
+    }
+    // an incomplete column is not shown
+    const float partialColumn[2] = { 1.0f, -1.0f };
+    scope.addFrame(partialColumn, 2);
+
+    unique_ptr< ScopeFrame > scopeFrame(new ScopeFrame());
+    scope.fill(*scopeFrame);
+
+    for (size_t column=0; column<ScopeFrame::NUMBER_OF_COLUMNS; column++){
+        const size_t first = (column + 10) * samplesPerColumn;
+        for (size_t channel=0; channel<2; channel++){
+            float minimum = INFINITY, maximum = -INFINITY;
+            for (size_t i=first; i<first + samplesPerColumn; i++){
+                minimum = min(minimum, samples[2*i + channel]);
+                maximum = max(maximum, samples[2*i + channel]);
+            }
+            if (scopeFrame->minimum[channel][column] != minimum || scopeFrame->maximum[channel][column] != maximum){
+                cout << "Different ! column " << column << " channel " << channel << endl;
+                throw WrongScopeException();
+            }
+        }
+    }
+
+    // opposite channels : no mid, every hit on the middle row
+    const size_t size = ScopeFrame::GONIOMETER_SIZE;
+    for (size_t cell=0; cell<size*size; cell++){
+        if ((cell / size != size/2) && scopeFrame->goniometer[cell] != 0){
+            cout << "Different ! goniometer cell " << cell << endl;
+            throw WrongScopeException();
+        }
+    }
+
+    cout << "Test OK: scope over " << samples.size()/2 << " frames" << endl;
+}
+
+void FFTTester::testLevelMeter(){
+    // a quarter of the sample rate, half way between two zero crossings :
+    // every sample is at 0.707 but the sine goes up to 1, 3 dB above
+    const size_t numberOfSamples = 4096;
+    vector< float > samples(numberOfSamples);
+    for (size_t i=0; i<numberOfSamples; i++){
+        samples[i] = (float)sin(M_PI / 2.0 * (double)i + M_PI / 4.0);
+    }
+
+    // the same measures whatever the blocks, the filter carries over
+    LevelMeter byBlocks;
+    LevelMeter bySamples;
+    double sumOfSquares = 0.0;
+    float peak = 0.0f;
+    float truePeak = 0.0f;
+    for (size_t i=0; i<numberOfSamples; i+=128){
+        const LevelMeasures measures = byBlocks.measure(&samples[i], 128);
+        float sampleTruePeak = 0.0f;
+        for (size_t j=i; j<i+128; j++){
+            sampleTruePeak = max(sampleTruePeak, bySamples.measure(&samples[j], 1).truePeak);
+        }
+        if (abs(measures.truePeak - sampleTruePeak) > 1e-5){
+            cout << "Different ! " << measures.truePeak << " vs " << sampleTruePeak << endl;
+            throw WrongLevelMeterException();
+        }
+        sumOfSquares += measures.sumOfSquares;
+        peak = max(peak, measures.peak);
+        if (i > 0){
+            // the sudden start of the sine rings through the filter
+            truePeak = max(truePeak, measures.truePeak);
+        }
+    }
+
+    if (abs(sqrt(sumOfSquares / numberOfSamples) - sqrt(0.5)) > 1e-4 ||
+        abs(peak - sqrt(0.5)) > 1e-4 ||
+        abs(toDbfs(truePeak)) > 0.05){
+        cout << "Different ! RMS " << sqrt(sumOfSquares / numberOfSamples) << ", peak " << peak
+             << ", true peak " << toDbfs(truePeak) << " dBFS" << endl;
+        throw WrongLevelMeterException();
+    }
+    if (toDbfs(0.0) != SILENCE_DBFS || abs(toDbfs(0.5) + 6.0206) > 1e-3){
+        throw WrongLevelMeterException();
+    }
+
+    cout << "Test OK: level meter" << endl;
+}
+
+// Spectra of many streams, all given to the first worker: the others have
+// to steal them, and the results must not depend on who ran what.
+void FFTTester::testWorkStealingPool(){
+    const size_t numberOfStreams = 64;
+    const size_t frameSize = 256;
+    vector< vector< float > > spectra(numberOfStreams);
+    atomic< size_t > numberOfFollowUps(0);
+    {
+        WorkStealingPool pool(4, false);
+        for (size_t stream=0; stream<numberOfStreams; stream++){
+            pool.submit([&, stream](){
+                            vector< float > samples(frameSize);
+                            for (size_t i=0; i<frameSize; i++){
+                                samples[i] = (float)sin(2.0 * M_PI * (double)(stream % 100) * i / frameSize);
+                            }
+                            spectra[stream] = RealFFTFloat(samples, frameSize).computeFrequentialAmplitudes();
+                            // a task can submit others
+                            pool.submit([&numberOfFollowUps](){ numberOfFollowUps++; }, stream);
+                        },
+                        0);
+        }
+        pool.waitForAll();
+
+        const WorkStealingStatistics statistics = pool.getStatistics();
+        if (statistics.executedTasks != 2*numberOfStreams || numberOfFollowUps.load() != numberOfStreams){
+            cout << "Different ! " << statistics.executedTasks << " tasks executed" << endl;
+            throw WrongWorkStealingPoolException();
+        }
+    }
+
+    for (size_t stream=0; stream<numberOfStreams; stream++){
+        const size_t bin = stream % 100;
+        const float expected = (bin == 0) ? 0.0f : frameSize / 2.0f;
+        if (abs(spectra[stream][bin] - expected) > 0.01f){
+            cout << "Different ! stream " << stream << " : " << spectra[stream][bin] << " vs " << expected << endl;
+            throw WrongWorkStealingPoolException();
+        }
+    }
+
+    cout << "Test OK: work stealing pool over " << numberOfStreams << " streams" << endl;
+}
+
 Polynomial FFTTester::generateRandomPolynomial(){
     int size = rand() % 8000;
     Polynomial result(size, 0.0);
@@ -66,6 +516,43 @@ void FFTTester::test(){
         testPolynomialsProduct(p1, p2);
     }
 
+    testKernels< double >();
+    testKernels< float >();
+
+    for (size_t size : {1, 3, 5, 6, 7, 12, 13, 15, 20, 30, 97, 100, 441, 480, 1000, 1021}){
+        testArbitrarySizeTransform(size);
+    }
+
+    testSlidingDFT();
+    testScope();
+    testLevelMeter();
+    testWorkStealingPool();
+
+    testSTFT(WindowType::hann);
+    testSTFT(WindowType::blackmanHarris);
+    testSTFT(WindowType::flatTop);
+    testSTFTHopSize();
+    testStereoSTFT();
+    for (size_t numberOfChannels : {1, 2, 3, 4, 8}){
+        testMultichannelSTFT(numberOfChannels);
+    }
+
+    testFixedSizeTransform< 2, double >();
+    testFixedSizeTransform< 16, double >();
+    testFixedSizeTransform< 512, double >();
+    testFixedSizeTransform< 512, float >();
+    testFixedSizeTransform< 1024, float >();
+
+    {
+        for (int size : {2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 6, 14, 480, 882}){
+            Polynomial p(size, 0.0);
+            for (auto &c : p){
+                c = ((rand() % 2000)-1000)/10.0;
+            }
+            testRealTransform(p);
+        }
+    }
+
     {
         for (int i=0; i<100; i++){
             Polynomial p1 = generateRandomPolynomial();
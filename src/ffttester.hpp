@@ -2,6 +2,8 @@
 #define FFT_TESTER_HPP
 
 #include "fft.hpp"
+#include "stft.hpp"
+#include "scope.hpp"
 
 
 
@@ -10,12 +12,37 @@ public:
     void test();
 
     class WrongFastProductException : std::exception {};
+    class WrongRealTransformException : std::exception {};
+    class WrongKernelException : std::exception {};
+    class WrongFixedSizeTransformException : std::exception {};
+    class WrongArbitrarySizeTransformException : std::exception {};
+    class WrongSTFTException : std::exception {};
+    class WrongStereoSTFTException : std::exception {};
+    class WrongMultichannelSTFTException : std::exception {};
+    class WrongSlidingDFTException : std::exception {};
+    class WrongScopeException : std::exception {};
+    class WrongLevelMeterException : std::exception {};
+    class WrongWorkStealingPoolException : std::exception {};
 private:
     void displayPolynomial(const Polynomial &p);
     Polynomial getTrivialProduct(const Polynomial &p1, const Polynomial &p2);
     Polynomial getFastProduct(const Polynomial &p1, const Polynomial &p2);
     bool polynomialsAreEqual(const Polynomial &p1, const Polynomial &p2);
     void testPolynomialsProduct(const Polynomial &p1, const Polynomial &p2);
+    void testRealTransform(const Polynomial &p);
+    void testArbitrarySizeTransform(size_t size);
+    void testSTFT(WindowType windowType);
+    void testSTFTHopSize();
+    void testStereoSTFT();
+    void testMultichannelSTFT(size_t numberOfChannels);
+    void testSlidingDFT();
+    void testScope();
+    void testLevelMeter();
+    void testWorkStealingPool();
+    template < typename T >
+    void testKernels();
+    template < size_t N, typename T >
+    void testFixedSizeTransform();
     Polynomial generateRandomPolynomial();
 };
 
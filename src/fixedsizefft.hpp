@@ -0,0 +1,178 @@
+#ifndef FIXED_SIZE_FFT_HPP
+#define FIXED_SIZE_FFT_HPP
+
+#include <array>
+#include <complex>
+#include <type_traits>
+#include <cstddef>
+
+#include "fftkernels.hpp"
+
+
+// Sine and cosine usable in constant expressions (std::sin is not constexpr).
+// The angle is brought back to [-pi/2, pi/2] where the Taylor series
+// converges to double precision in a few terms.
+constexpr long double constexprPi = 3.141592653589793238462643383279502884L;
+
+constexpr long double constexprTaylorSin(long double x){
+    long double term = x;
+    long double sum = x;
+    for (int n=1; n<20; n++){
+        term *= -x*x / ((2*n) * (2*n+1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr long double constexprTaylorCos(long double x){
+    long double term = 1.0L;
+    long double sum = 1.0L;
+    for (int n=1; n<20; n++){
+        term *= -x*x / ((2*n-1) * (2*n));
+        sum += term;
+    }
+    return sum;
+}
+
+// Only valid for angles in [0, pi], which is all the twiddles need.
+constexpr long double constexprSin(long double angle){
+    return angle > constexprPi/2 ? constexprTaylorSin(constexprPi - angle) : constexprTaylorSin(angle);
+}
+constexpr long double constexprCos(long double angle){
+    return angle > constexprPi/2 ? -constexprTaylorCos(constexprPi - angle) : constexprTaylorCos(angle);
+}
+
+
+// The tables of FixedSizeFFT, generated by the compiler. Same layout as
+// FFTEngine : the stage combining blocks of 2*h points reads its h twiddles
+// from offset h-1. The twiddles are stored as interleaved (real, imaginary)
+// pairs so that they can be handed to the SIMD kernels as std::complex.
+template < size_t N, typename T >
+struct FixedSizeFFTTables {
+    T twiddles[2*(N-1)];
+    T inverseTwiddles[2*(N-1)];
+    size_t bitReversal[N];
+};
+
+template < size_t N, typename T >
+constexpr FixedSizeFFTTables< N, T > makeFixedSizeFFTTables(){
+    FixedSizeFFTTables< N, T > tables{};
+
+    size_t offset = 0;
+    for (size_t half=1; half<N; half*=2){
+        for (size_t k=0; k<half; k++){
+            const long double angle = constexprPi * (long double)k / (long double)half;
+            tables.twiddles[2*(offset + k)] = (T)constexprCos(angle);
+            tables.twiddles[2*(offset + k) + 1] = (T)constexprSin(angle);
+            tables.inverseTwiddles[2*(offset + k)] = (T)constexprCos(angle);
+            tables.inverseTwiddles[2*(offset + k) + 1] = -(T)constexprSin(angle);
+        }
+        offset += half;
+    }
+
+    size_t numberOfBits = 0;
+    while (((size_t)1 << numberOfBits) < N){
+        numberOfBits++;
+    }
+    for (size_t i=0; i<N; i++){
+        size_t reversed = 0;
+        for (size_t bit=0; bit<numberOfBits; bit++){
+            if (i & ((size_t)1 << bit)){
+                reversed |= (size_t)1 << (numberOfBits - 1 - bit);
+            }
+        }
+        tables.bitReversal[i] = reversed;
+    }
+    return tables;
+}
+
+
+// FFT whose size is known at compile time, for the real-time paths where the
+// number of frames per buffer is a constant. The storage is fixed and
+// aligned, the tables are computed by the compiler and every stage is a
+// separate instantiation, so the loops of the small stages have constant
+// trip counts and can be fully unrolled. The wide stages, where vectors pay
+// off more than unrolling, still go through the SIMD kernels.
+// It is named FixedSizeFFT rather than FFT< N, T > because FFT is already
+// the runtime-sized class used by FFTTester.
+template < size_t N, typename T = float >
+class FixedSizeFFT {
+    static_assert(N >= 2 && (N & (N-1)) == 0, "FixedSizeFFT needs a power of two number of points");
+public:
+    using ComplexType = std::complex< T >;
+
+    void setValue(size_t index, const ComplexType &value){
+        m_coefs[index] = value;
+    }
+
+    const std::array< ComplexType, N > &computeEval(){
+        eval(false);
+        return m_evalResults;
+    }
+
+    const std::array< ComplexType, N > &computeEvalInverse(){
+        eval(true);
+        getFFTKernels< T >().scale(m_evalResults.data(), s_inverseScale, N);
+        return m_evalResults;
+    }
+
+    const std::array< T, N > &computeFrequentialAmplitudes(){
+        eval(false);
+        getFFTKernels< T >().magnitudes(m_evalResults.data(), m_frequentialAmplitudes.data(), N);
+        return m_frequentialAmplitudes;
+    }
+
+private:
+    static constexpr FixedSizeFFTTables< N, T > s_tables = makeFixedSizeFFTTables< N, T >();
+    static constexpr T s_inverseScale = (T)1 / (T)N;
+
+    alignas(32) std::array< ComplexType, N > m_coefs = {};
+    alignas(32) std::array< ComplexType, N > m_evalResults = {};
+    alignas(32) std::array< T, N > m_frequentialAmplitudes = {};
+
+    // Stages combining blocks of up to 2*s_largestUnrolledHalf points are
+    // unrolled, the following ones use the kernels.
+    static const size_t s_largestUnrolledHalf = 4;
+
+    void eval(bool inverse){
+        for (size_t i=0; i<N; i++){
+            m_evalResults[i] = m_coefs[s_tables.bitReversal[i]];
+        }
+        const T *twiddles = inverse ? s_tables.inverseTwiddles : s_tables.twiddles;
+        stage(std::integral_constant< size_t, 1 >(), twiddles);
+    }
+
+    template < size_t Half >
+    void stage(std::integral_constant< size_t, Half >, const T *twiddles){
+        const ComplexType *stageTwiddles = reinterpret_cast< const ComplexType * >(twiddles) + Half - 1;
+
+        if (Half > s_largestUnrolledHalf){
+            getFFTKernels< T >().butterflyStage(m_evalResults.data(), N, Half, stageTwiddles);
+        } else {
+            for (size_t start=0; start<N; start+=2*Half){
+                ComplexType *even = &m_evalResults[start];
+                ComplexType *odd = even + Half;
+                for (size_t i=0; i<Half; i++){
+                    const T wr = stageTwiddles[i].real();
+                    const T wi = stageTwiddles[i].imag();
+                    const T tr = wr*odd[i].real() - wi*odd[i].imag();
+                    const T ti = wr*odd[i].imag() + wi*odd[i].real();
+                    odd[i] = ComplexType(even[i].real() - tr, even[i].imag() - ti);
+                    even[i] = ComplexType(even[i].real() + tr, even[i].imag() + ti);
+                }
+            }
+        }
+        stage(std::integral_constant< size_t, 2*Half >(), twiddles);
+    }
+
+    void stage(std::integral_constant< size_t, N >, const T *){
+    }
+};
+
+template < size_t N, typename T >
+constexpr FixedSizeFFTTables< N, T > FixedSizeFFT< N, T >::s_tables;
+
+template < size_t N, typename T >
+constexpr T FixedSizeFFT< N, T >::s_inverseScale;
+
+#endif
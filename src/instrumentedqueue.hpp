@@ -0,0 +1,189 @@
+#ifndef INSTRUMENTED_QUEUE_HPP
+#define INSTRUMENTED_QUEUE_HPP
+
+#include "readerwriterqueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+// What an InstrumentedQueue has seen since it was created.
+struct QueueStatistics {
+    uint64_t enqueued;          // elements accepted
+    uint64_t failedEnqueues;    // try_enqueue calls refused because the queue was full
+    uint64_t dequeued;
+    uint64_t peakDepth;         // most elements waiting at once
+    double averageLatencyUs;    // time spent in the queue by the dequeued elements
+    double maxLatencyUs;
+};
+
+
+// moodycamel::ReaderWriterQueue with counters, selected instead of the
+// plain queue by VUMETER_QUEUE_STATS (see rwqueuetype.hpp). Each element is
+// stamped when enqueued, so that the consumer can measure how long it
+// waited. Every counter has a single writer, the producer or the consumer,
+// and is atomic, so that any thread can read the statistics without
+// locking while the queue is in use.
+template < typename T >
+class InstrumentedQueue {
+public:
+    explicit InstrumentedQueue(size_t maxSize = 15) :
+        m_queue(maxSize),
+        m_enqueued(0),
+        m_failedEnqueues(0),
+        m_peakDepth(0),
+        m_dequeued(0),
+        m_latencySumNs(0),
+        m_latencyMaxNs(0)
+    {}
+
+    // Producer
+    bool try_enqueue(const T &element){
+        return countEnqueued(m_queue.try_enqueue(Stamped{ element, now() }) ? 1 : 0, 1);
+    }
+    bool try_enqueue(T &&element){
+        return countEnqueued(m_queue.try_enqueue(Stamped{ std::move(element), now() }) ? 1 : 0, 1);
+    }
+    bool enqueue(const T &element){
+        return countEnqueued(m_queue.enqueue(Stamped{ element, now() }) ? 1 : 0, 1);
+    }
+    size_t try_enqueue_bulk(const T *elements, size_t count){
+        const std::chrono::steady_clock::time_point stamp = now();
+        Stamped batch[BATCH_SIZE];
+        size_t enqueued = 0;
+        while (enqueued < count){
+            const size_t batchCount = std::min(count - enqueued, BATCH_SIZE);
+            for (size_t i=0; i<batchCount; i++){
+                batch[i] = Stamped{ elements[enqueued + i], stamp };
+            }
+            const size_t batchEnqueued = m_queue.try_enqueue_bulk(batch, batchCount);
+            enqueued += batchEnqueued;
+            if (batchEnqueued < batchCount){
+                break;
+            }
+        }
+        countEnqueued(enqueued, count);
+        return enqueued;
+    }
+
+    // Consumer
+    template < typename U >
+    bool try_dequeue(U &result){
+        Stamped stamped;
+        if (!m_queue.try_dequeue(stamped)){
+            return false;
+        }
+        result = std::move(stamped.value);
+        countDequeued(&stamped, 1);
+        return true;
+    }
+    size_t try_dequeue_bulk(T *results, size_t maxCount){
+        Stamped batch[BATCH_SIZE];
+        size_t dequeued = 0;
+        while (dequeued < maxCount){
+            const size_t batchDequeued = m_queue.try_dequeue_bulk(batch, std::min(maxCount - dequeued, BATCH_SIZE));
+            for (size_t i=0; i<batchDequeued; i++){
+                results[dequeued + i] = std::move(batch[i].value);
+            }
+            countDequeued(batch, batchDequeued);
+            dequeued += batchDequeued;
+            if (batchDequeued == 0){
+                break;
+            }
+        }
+        return dequeued;
+    }
+    T *peek(){
+        Stamped *stamped = m_queue.peek();
+        return stamped ? &stamped->value : nullptr;
+    }
+    bool pop(){
+        Stamped *stamped = m_queue.peek();
+        if (!stamped){
+            return false;
+        }
+        countDequeued(stamped, 1);
+        return m_queue.pop();
+    }
+
+    // Any thread
+    size_t size_approx() const {
+        return m_queue.size_approx();
+    }
+
+    QueueStatistics getStatistics() const {
+        QueueStatistics statistics;
+        statistics.enqueued = m_enqueued.load(std::memory_order_relaxed);
+        statistics.failedEnqueues = m_failedEnqueues.load(std::memory_order_relaxed);
+        statistics.dequeued = m_dequeued.load(std::memory_order_relaxed);
+        statistics.peakDepth = m_peakDepth.load(std::memory_order_relaxed);
+        statistics.averageLatencyUs = statistics.dequeued ?
+            m_latencySumNs.load(std::memory_order_relaxed) / 1000.0 / statistics.dequeued : 0.0;
+        statistics.maxLatencyUs = m_latencyMaxNs.load(std::memory_order_relaxed) / 1000.0;
+        return statistics;
+    }
+
+private:
+    static const size_t BATCH_SIZE = 64;
+
+    struct Stamped {
+        T value;
+        std::chrono::steady_clock::time_point enqueueTime;
+    };
+
+    moodycamel::ReaderWriterQueue< Stamped > m_queue;
+
+    // written by the producer
+    std::atomic< uint64_t > m_enqueued;
+    std::atomic< uint64_t > m_failedEnqueues;
+    std::atomic< uint64_t > m_peakDepth;
+
+    // written by the consumer
+    std::atomic< uint64_t > m_dequeued;
+    std::atomic< uint64_t > m_latencySumNs;
+    std::atomic< uint64_t > m_latencyMaxNs;
+
+    static std::chrono::steady_clock::time_point now(){
+        return std::chrono::steady_clock::now();
+    }
+
+    // A single writer : no need for an atomic read-modify-write.
+    static void add(std::atomic< uint64_t > &counter, uint64_t value){
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    bool countEnqueued(size_t enqueued, size_t count){
+        add(m_enqueued, enqueued);
+        if (enqueued < count){
+            add(m_failedEnqueues, 1);
+        }
+        const uint64_t depth = m_enqueued.load(std::memory_order_relaxed) - m_dequeued.load(std::memory_order_relaxed);
+        if (depth > m_peakDepth.load(std::memory_order_relaxed)){
+            m_peakDepth.store(depth, std::memory_order_relaxed);
+        }
+        return enqueued == count;
+    }
+
+    void countDequeued(const Stamped *stamped, size_t count){
+        if (count == 0){
+            return;
+        }
+        const std::chrono::steady_clock::time_point dequeueTime = now();
+        uint64_t latencyMaxNs = m_latencyMaxNs.load(std::memory_order_relaxed);
+        uint64_t latencySumNs = 0;
+        for (size_t i=0; i<count; i++){
+            const uint64_t latencyNs = std::chrono::duration_cast< std::chrono::nanoseconds >(dequeueTime - stamped[i].enqueueTime).count();
+            latencySumNs += latencyNs;
+            latencyMaxNs = std::max(latencyMaxNs, latencyNs);
+        }
+        add(m_latencySumNs, latencySumNs);
+        m_latencyMaxNs.store(latencyMaxNs, std::memory_order_relaxed);
+        add(m_dequeued, count);
+    }
+};
+
+#endif
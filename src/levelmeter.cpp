@@ -0,0 +1,163 @@
+#include "levelmeter.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+// SSE2 is part of x86-64, and NEON has to be enabled at compile time on
+// 32 bits ARM anyway: no runtime detection, as for the deinterleaving.
+#if defined(__SSE2__)
+#define LEVEL_METER_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LEVEL_METER_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+
+float toDbfs(double amplitude){
+    if (amplitude <= 0.0){
+        return SILENCE_DBFS;
+    }
+    return max(SILENCE_DBFS, (float)(20.0 * log10(amplitude)));
+}
+
+
+// 47 taps of a sinc cut at the original Nyquist frequency, through a
+// Blackman window, and a 48th null tap to fill the last vector. The center
+// tap is phase 3 of the sample 5 steps back, the only non zero tap of its
+// phase: that phase reproduces the input. The other phases are normalized
+// to a gain of 1 at DC.
+static vector< float > computeCoefficients(){
+    static const double pi = std::acos(-1);
+    const size_t numberOfTaps = LevelMeter::OVERSAMPLING * LevelMeter::TAPS_PER_PHASE;
+    const size_t length = numberOfTaps - 1;
+    const double center = (double)(length - 1) / 2.0;
+
+    vector< double > taps(numberOfTaps, 0.0);
+    for (size_t j=0; j<length; j++){
+        const double x = ((double)j - center) / (double)LevelMeter::OVERSAMPLING;
+        const double sinc = (x == 0.0) ? 1.0 : sin(pi * x) / (pi * x);
+        const double angle = 2.0 * pi * (double)j / (double)(length - 1);
+        taps[j] = sinc * (0.42 - 0.5 * cos(angle) + 0.08 * cos(2.0 * angle));
+    }
+
+    vector< float > coefficients(numberOfTaps);
+    for (size_t phase=0; phase<LevelMeter::OVERSAMPLING; phase++){
+        double gain = 0.0;
+        for (size_t j=phase; j<numberOfTaps; j+=LevelMeter::OVERSAMPLING){
+            gain += taps[j];
+        }
+        for (size_t j=phase; j<numberOfTaps; j+=LevelMeter::OVERSAMPLING){
+            // taps[j] weights the sample j / OVERSAMPLING steps back
+            coefficients[j] = (float)(taps[j] / gain);
+        }
+    }
+    return coefficients;
+}
+
+
+LevelMeter::LevelMeter() :
+    m_coefficients(computeCoefficients()),
+    m_samples(HISTORY_SIZE + MAX_BLOCK_SIZE, 0.0f)
+{
+}
+
+// samples[-HISTORY_SIZE] to samples[-1] are the history of the filter.
+static LevelMeasures measureBlock(const float *samples, size_t count, const float *coefficients){
+    const size_t taps = LevelMeter::TAPS_PER_PHASE;
+    float sumOfSquares = 0.0f;
+    float peak = 0.0f;
+    float truePeak = 0.0f;
+    size_t i = 0;
+
+#if defined(LEVEL_METER_SSE2)
+    const __m128 absoluteMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 sums = _mm_setzero_ps();
+    __m128 peaks = _mm_setzero_ps();
+    __m128 truePeaks = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4){
+        const __m128 block = _mm_loadu_ps(samples + i);
+        sums = _mm_add_ps(sums, _mm_mul_ps(block, block));
+        peaks = _mm_max_ps(peaks, _mm_and_ps(block, absoluteMask));
+        for (size_t j=i; j<i+4; j++){
+            __m128 phases = _mm_mul_ps(_mm_loadu_ps(coefficients), _mm_set1_ps(samples[j]));
+            for (size_t k=1; k<taps; k++){
+                phases = _mm_add_ps(phases, _mm_mul_ps(_mm_loadu_ps(coefficients + 4*k), _mm_set1_ps(samples[j - k])));
+            }
+            truePeaks = _mm_max_ps(truePeaks, _mm_and_ps(phases, absoluteMask));
+        }
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sums);
+    sumOfSquares = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, peaks);
+    peak = max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3]));
+    _mm_storeu_ps(lanes, truePeaks);
+    truePeak = max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3]));
+#elif defined(LEVEL_METER_NEON)
+    float32x4_t sums = vdupq_n_f32(0.0f);
+    float32x4_t peaks = vdupq_n_f32(0.0f);
+    float32x4_t truePeaks = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4){
+        const float32x4_t block = vld1q_f32(samples + i);
+        sums = vmlaq_f32(sums, block, block);
+        peaks = vmaxq_f32(peaks, vabsq_f32(block));
+        for (size_t j=i; j<i+4; j++){
+            float32x4_t phases = vmulq_n_f32(vld1q_f32(coefficients), samples[j]);
+            for (size_t k=1; k<taps; k++){
+                phases = vmlaq_n_f32(phases, vld1q_f32(coefficients + 4*k), samples[j - k]);
+            }
+            truePeaks = vmaxq_f32(truePeaks, vabsq_f32(phases));
+        }
+    }
+    float lanes[4];
+    vst1q_f32(lanes, sums);
+    sumOfSquares = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    vst1q_f32(lanes, peaks);
+    peak = max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3]));
+    vst1q_f32(lanes, truePeaks);
+    truePeak = max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3]));
+#endif
+
+    for (; i<count; i++){
+        sumOfSquares += samples[i] * samples[i];
+        peak = max(peak, abs(samples[i]));
+        for (size_t phase=0; phase<LevelMeter::OVERSAMPLING; phase++){
+            float value = 0.0f;
+            for (size_t k=0; k<taps; k++){
+                value += coefficients[4*k + phase] * samples[i - k];
+            }
+            truePeak = max(truePeak, abs(value));
+        }
+    }
+
+    LevelMeasures measures;
+    measures.sumOfSquares = sumOfSquares;
+    measures.peak = peak;
+    measures.truePeak = truePeak;
+    return measures;
+}
+
+LevelMeasures LevelMeter::measure(const float *samples, size_t count){
+    LevelMeasures measures = { 0.0f, 0.0f, 0.0f };
+    while (count > 0){
+        const size_t blockSize = min(count, (size_t)MAX_BLOCK_SIZE);
+        copy(samples, samples + blockSize, &m_samples[HISTORY_SIZE]);
+        const LevelMeasures blockMeasures = measureBlock(&m_samples[HISTORY_SIZE], blockSize, m_coefficients.data());
+        copy(&m_samples[blockSize], &m_samples[blockSize + HISTORY_SIZE], &m_samples[0]);
+
+        measures.sumOfSquares += blockMeasures.sumOfSquares;
+        measures.peak = max(measures.peak, blockMeasures.peak);
+        measures.truePeak = max(measures.truePeak, blockMeasures.truePeak);
+        samples += blockSize;
+        count -= blockSize;
+    }
+    // the filter delays the samples: the latest ones reach the true peak
+    // with the next block only
+    measures.truePeak = max(measures.truePeak, measures.peak);
+    return measures;
+}
@@ -0,0 +1,54 @@
+#ifndef LEVEL_METER_HPP
+#define LEVEL_METER_HPP
+
+#include <vector>
+#include <cstddef>
+
+
+// Level in dBFS given to silence, below what 24 bits samples can carry.
+const float SILENCE_DBFS = -150.0f;
+
+// 0 dBFS is an amplitude of 1, the full scale of the float samples: a full
+// scale sine has an RMS of -3 dBFS.
+float toDbfs(double amplitude);
+
+
+// What a LevelMeter measured over a block of samples.
+struct LevelMeasures {
+    float sumOfSquares;
+    float peak;        // largest absolute sample
+    float truePeak;    // largest absolute value between the samples too
+};
+
+// Sample peak, sum of squares and true peak of one channel, in a single
+// pass over each block, with SSE2 or NEON when the build has them.
+// The true peak is the peak of the signal oversampled 4 times by a
+// polyphase FIR, as recommended by ITU-R BS.1770: the 4 phases of each
+// input sample are computed together, one per vector lane, so it costs 12
+// vector multiply-adds per sample. A sine near a quarter of the sample
+// rate can peak 3 dB above its samples, which the sample peak misses.
+// The filter is a windowed sinc whose phase 3 is the input itself, delayed
+// by 5 samples, and the true peak of a block is never below its sample
+// peak. The filter keeps its history from one block to the next, so the
+// blocks can be of any size.
+class LevelMeter {
+public:
+    static const size_t OVERSAMPLING = 4;
+    static const size_t TAPS_PER_PHASE = 12;
+
+    LevelMeter();
+
+    LevelMeasures measure(const float *samples, size_t count);
+
+private:
+    static const size_t HISTORY_SIZE = TAPS_PER_PHASE - 1;
+    static const size_t MAX_BLOCK_SIZE = 256;
+
+    // coefficient of the sample k steps back for each phase p, at
+    // k * OVERSAMPLING + p, so that the 4 phases load as one vector
+    std::vector< float > m_coefficients;
+    // the latest HISTORY_SIZE samples, followed by the block being measured
+    std::vector< float > m_samples;
+};
+
+#endif
@@ -1,7 +1,7 @@
 #include "listener.hpp"
 #include "sanity.hpp"
 #include "portaudiostreamer.hpp"
-#include "fft.hpp"
+#include "analysisframe.hpp"
 
 #include <iostream>
 #include <iomanip>
@@ -21,40 +21,32 @@ const int FRAMES_PER_BUFFER = (1 << 9);
 // The callback is called every FRAMES_PER_BUFFER/SampleRate :
 // 512 samples / 16000 Hz = 32 ms.
 
+const double INPUT_SAMPLE_RATE = 16000;
+
 
 
 class InputStreamer : public PortAudioStreamer {
-    RWQueue *m_lockFreeQueue;
-    RWVectorQueue *m_lockFreeVectorQueue;
-    bool m_stereo;
-    FFT m_fft;
+    SampleRing *m_sampleRing;
+    size_t m_numberOfChannels;
     high_resolution_clock::time_point m_lastTime;
 
     int audioCallback(const void *inputBuffer, void *outputBuffer,
                       unsigned long framesPerBuffer,
                       const PaStreamCallbackTimeInfo* timeInfo,
                       PaStreamCallbackFlags statusFlags){
-        float *in = (float*)inputBuffer;
-        double avg = 0.0;
-
-        for(unsigned long i=0; i<framesPerBuffer; i++ )
-        {
-            float left = *in++;
-            float leftSq = left*left*256*256;
-            float rightSq = 0;
-
-            if (m_stereo){
-                float right = *in++;
-                rightSq = right*right*256*256;
-                avg += (((leftSq + rightSq)/2.0));
-            } else {
-                avg += (leftSq);
-            }
-            m_fft.setValue(i, Complex(left, 0.0));
-            // m_fftTime[i] = Complex(left, 0.0);
+        // the level and the spectrum are computed by the Analyzer thread
+        const float *in = (const float*)inputBuffer;
+        if (statusFlags & paInputOverflow){
+            m_sampleRing->countInputOverflow();
+        }
+        if (statusFlags & paInputUnderflow){
+            m_sampleRing->countInputUnderflow();
         }
-        m_lockFreeQueue->try_enqueue((int)(avg*10.0/framesPerBuffer));
-        m_lockFreeVectorQueue->try_enqueue(m_fft.computeFrequentialAmplitudes());
+        // inputBufferAdcTime is left to 0 by the host APIs which don't know it
+        const double adcTime = timeInfo->inputBufferAdcTime > 0 ? timeInfo->inputBufferAdcTime : timeInfo->currentTime;
+        const steady_clock::time_point captureTime = steady_clock::now()
+            - duration_cast< steady_clock::duration >(duration< double >(timeInfo->currentTime - adcTime));
+        m_sampleRing->write(in, framesPerBuffer * m_numberOfChannels, adcTime, captureTime);
 
         // high_resolution_clock::time_point t1 = high_resolution_clock::now();
         // duration<double, std::milli> time_span = t1 - m_lastTime;
@@ -66,19 +58,20 @@ class InputStreamer : public PortAudioStreamer {
     }
 public:
     explicit InputStreamer(const DeviceFinder &deviceFinder,
-                           RWQueue *lockFreeQueue,
-                           RWVectorQueue *lockFreeVectorQueue) :
+                           SampleRing *sampleRing) :
         PortAudioStreamer(deviceFinder,
                           deviceFinder.getInputStreamParameters(),
                           nullopt,
-                          16000,
+                          INPUT_SAMPLE_RATE,
                           FRAMES_PER_BUFFER),
-        m_lockFreeQueue(lockFreeQueue),
-        m_lockFreeVectorQueue(lockFreeVectorQueue),
-        m_stereo(m_inputParameters->channelCount == 2),
-        m_fft(ComplexPolynomial(m_framesPerBuffer), m_framesPerBuffer),
+        m_sampleRing(sampleRing),
+        m_numberOfChannels(min((size_t)m_inputParameters->channelCount, (size_t)AnalysisFrame::MAX_NUMBER_OF_CHANNELS)),
         m_lastTime()
-    {}
+    {
+        // every channel of the device, as many as the analysis can meter
+        m_inputParameters->channelCount = (int)m_numberOfChannels;
+        m_sampleRing->setNumberOfChannels(m_numberOfChannels);
+    }
 
     void waitForever(){
         Sanity::checkNoError(openStream());
@@ -184,13 +177,10 @@ public:
 
 
 
-Listener::Listener(RWQueue *lockFreeQueue,
-                   RWVectorQueue *lockFreeVectorQueue,
-                   bool listDevices,
+Listener::Listener(bool listDevices,
                    const vector< string > &preferedInputDevices,
                    const vector< string > &preferedOutputDevices) :
-    m_lockFreeQueue(lockFreeQueue),
-    m_lockFreeVectorQueue(lockFreeVectorQueue),
+    m_sampleRing(nullptr),
     m_portAudioResource(PortAudioResource::getInstance()),
     m_deviceFinder(listDevices, preferedInputDevices, preferedOutputDevices)
 {
@@ -204,7 +194,16 @@ void Listener::playTwoSmallHighPitchSine(){
 }
 
 void Listener::reallyListen(){
-    InputStreamer(m_deviceFinder, m_lockFreeQueue, m_lockFreeVectorQueue).waitForever();
+    InputStreamer(m_deviceFinder, m_sampleRing).waitForever();
+}
+
+double Listener::getSampleRate() const {
+    return INPUT_SAMPLE_RATE;
+}
+
+void Listener::run(SampleRing *sampleRing){
+    m_sampleRing = sampleRing;
+    listenAndWrite();
 }
 
 void Listener::listenAndWrite(){
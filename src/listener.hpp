@@ -6,7 +6,8 @@
 #include <experimental/optional>
 #include <memory>
 
-#include "rwqueuetype.hpp"
+#include "samplering.hpp"
+#include "audiosource.hpp"
 #include "devicefinder.hpp"
 #include "portaudioresource.hpp"
 
@@ -16,20 +17,21 @@ class AudioInputCallbackContext;
 
 
 
-class Listener {
+// The live input: the preferred sound card found by the DeviceFinder,
+// through PortAudio.
+class Listener : public AudioSource {
 public:
-    explicit Listener(RWQueue *lockFreeQueue,
-                      RWVectorQueue *lockFreeVectorQueue,
-                      bool listDevices,
+    explicit Listener(bool listDevices,
                       const std::vector< std::string > &preferedInputDevices,
                       const std::vector< std::string > &preferedOutputDevices);
     ~Listener();
-    void listenAndWrite();
+    double getSampleRate() const override;
+    void run(SampleRing *sampleRing) override;
 private:
-    RWQueue *m_lockFreeQueue;
-    RWVectorQueue *m_lockFreeVectorQueue;
+    SampleRing *m_sampleRing;
     std::unique_ptr<PortAudioResource> m_portAudioResource;
     DeviceFinder m_deviceFinder;
+    void listenAndWrite();
     void playTwoSmallHighPitchSine();
     void reallyListen();
     AudioInputCallbackContext createInputContext();
@@ -1,13 +1,94 @@
 #include "vumeter.hpp"
+#include "wavfile.hpp"
 #include "ffttester.hpp"
+#include "fftbenchmark.hpp"
+#include "queuebenchmark.hpp"
 #include <signal.h>
 #include <iostream>
+#include <string>
+#include <cstdlib>
 
 void signalHandler(int s){
     std::cout << "Caught signal " << s << std::endl;
     exit(1);
 }
 
+void printUsage(const char *program){
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << "Input, the sound card by default:" << std::endl
+              << "  --wav FILE          play a WAV file" << std::endl
+              << "  --sine HZ           generate a sine" << std::endl
+              << "  --noise             generate white noise" << std::endl
+              << "  --sweep             generate repeated logarithmic sweeps" << std::endl
+              << "  --rate HZ           sample rate of the generator (16000)" << std::endl
+              << "  --stereo            generate two channels" << std::endl
+              << "  --channels N        generate N channels, up to " << AnalysisFrame::MAX_NUMBER_OF_CHANNELS << std::endl
+              << "  --seconds S         stop the generator after S seconds" << std::endl
+              << "  --fast              play the file or the generator as fast as it is analysed" << std::endl
+              << "Analysis:" << std::endl
+              << "  --monitor HZ        follow the bin nearest to HZ sample by sample, up to "
+              << AnalysisFrame::MAX_NUMBER_OF_MONITORED_BINS << " times" << std::endl
+              << "  --alarm DBFS        report a monitored bin above DBFS (-20)" << std::endl
+              << "Display:" << std::endl
+              << "  --headless          render offscreen, without a window" << std::endl
+              << "  --frames N          stop after drawing N frames" << std::endl
+              << "  --dump-raw DIR      write every frame to DIR as raw RGBA" << std::endl
+              << "  --dump-png DIR      write every frame to DIR as PNG" << std::endl
+              << "  --render-times      print render time percentiles at the end" << std::endl;
+}
+
+// Returns false on an unknown option or a missing value.
+bool parseOptions(int argc, char *argv[], AudioSourceOptions &sourceOptions, DisplayOptions &options,
+                  MonitorOptions &monitorOptions){
+    for (int i=1; i<argc; i++){
+        const std::string option = argv[i];
+        const bool hasValue = (i+1 < argc);
+        if (option == "--wav" && hasValue){
+            sourceOptions.kind = AudioSourceOptions::Kind::wavFile;
+            sourceOptions.wavFileName = argv[++i];
+        } else if (option == "--sine" && hasValue){
+            sourceOptions.kind = AudioSourceOptions::Kind::generator;
+            sourceOptions.signalType = SignalType::sine;
+            sourceOptions.frequency = std::strtod(argv[++i], NULL);
+        } else if (option == "--noise" || option == "--sweep"){
+            sourceOptions.kind = AudioSourceOptions::Kind::generator;
+            sourceOptions.signalType = (option == "--noise") ? SignalType::noise : SignalType::sweep;
+        } else if (option == "--rate" && hasValue){
+            sourceOptions.sampleRate = std::strtod(argv[++i], NULL);
+        } else if (option == "--stereo"){
+            sourceOptions.numberOfChannels = 2;
+        } else if (option == "--channels" && hasValue){
+            sourceOptions.numberOfChannels = std::strtoul(argv[++i], NULL, 10);
+            if (sourceOptions.numberOfChannels == 0 || sourceOptions.numberOfChannels > AnalysisFrame::MAX_NUMBER_OF_CHANNELS){
+                return false;
+            }
+        } else if (option == "--seconds" && hasValue){
+            sourceOptions.seconds = std::strtod(argv[++i], NULL);
+        } else if (option == "--fast"){
+            sourceOptions.pacing = Pacing::asFastAsPossible;
+        } else if (option == "--monitor" && hasValue){
+            if (monitorOptions.frequencies.size() == AnalysisFrame::MAX_NUMBER_OF_MONITORED_BINS){
+                return false;
+            }
+            monitorOptions.frequencies.push_back(std::strtod(argv[++i], NULL));
+        } else if (option == "--alarm" && hasValue){
+            monitorOptions.alarmDbfs = std::strtof(argv[++i], NULL);
+        } else if (option == "--headless"){
+            options.headless = true;
+        } else if (option == "--frames" && hasValue){
+            options.numberOfFrames = std::strtoull(argv[++i], NULL, 10);
+        } else if ((option == "--dump-raw" || option == "--dump-png") && hasValue){
+            options.dumpDirectory = argv[++i];
+            options.dumpPng = (option == "--dump-png");
+        } else if (option == "--render-times"){
+            options.reportRenderTimes = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
 int main(int argc, char *argv[]){
     // raise(SIGSTOP);  // start the debugger
 
@@ -18,8 +99,27 @@ int main(int argc, char *argv[]){
     sigIntHandler.sa_flags = 0;
     sigaction(SIGINT, &sigIntHandler, NULL);
 
-    VuMeter().start();
+    AudioSourceOptions audioSourceOptions;
+    DisplayOptions displayOptions;
+    MonitorOptions monitorOptions;
+    if (!parseOptions(argc, argv, audioSourceOptions, displayOptions, monitorOptions)){
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // WavFile has already printed why the file was refused
+    try {
+        VuMeter(audioSourceOptions, displayOptions, monitorOptions).start();
+    } catch (const WavFile::CannotOpenFileException &){
+        std::cout << "Cannot play " << audioSourceOptions.wavFileName << std::endl;
+        return 1;
+    } catch (const WavFile::UnsupportedFormatException &){
+        std::cout << "Cannot play " << audioSourceOptions.wavFileName << std::endl;
+        return 1;
+    }
     // FFTTester().test();
+    // FFTBenchmark().run();
+    // QueueBenchmark().run();
 
 }
 
@@ -0,0 +1,120 @@
+#include "queuebenchmark.hpp"
+#include "rwqueuetype.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+
+// A batchSize of 1 uses try_enqueue and try_dequeue, any other one the
+// bulk versions. The consumer checks the order of the elements, which also
+// keeps the compiler from skipping any of them.
+
+static size_t enqueue(RWQueue &queue, const double *elements, size_t count){
+    if (count == 1){
+        return queue.try_enqueue(elements[0]) ? 1 : 0;
+    }
+    return queue.try_enqueue_bulk(elements, count);
+}
+
+static size_t dequeue(RWQueue &queue, double *elements, size_t count){
+    if (count == 1){
+        return queue.try_dequeue(elements[0]) ? 1 : 0;
+    }
+    return queue.try_dequeue_bulk(elements, count);
+}
+
+double QueueBenchmark::measureSingleThread(size_t numberOfElements, size_t capacity, size_t batchSize){
+    RWQueue queue(capacity);
+    vector< double > batch(batchSize);
+    size_t nextIn = 0;
+    size_t nextOut = 0;
+
+    high_resolution_clock::time_point t0 = high_resolution_clock::now();
+    while (nextOut < numberOfElements){
+        // fill
+        size_t enqueued = 1;
+        while (nextIn < numberOfElements && enqueued > 0){
+            const size_t count = min(batchSize, numberOfElements - nextIn);
+            for (size_t i=0; i<count; i++){
+                batch[i] = (double)(nextIn + i);
+            }
+            enqueued = enqueue(queue, batch.data(), count);
+            nextIn += enqueued;
+        }
+        // drain
+        size_t count;
+        while ((count = dequeue(queue, batch.data(), batchSize)) > 0){
+            for (size_t i=0; i<count; i++){
+                if (batch[i] != (double)(nextOut + i)){
+                    throw WrongOrderException();
+                }
+            }
+            nextOut += count;
+        }
+    }
+    high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+    return numberOfElements / duration<double>(t1 - t0).count();
+}
+
+double QueueBenchmark::measureTwoThreads(size_t numberOfElements, size_t capacity, size_t batchSize){
+    RWQueue queue(capacity);
+
+    high_resolution_clock::time_point t0 = high_resolution_clock::now();
+    thread producer([&queue, numberOfElements, batchSize](){
+        vector< double > batch(batchSize);
+        size_t next = 0;
+        while (next < numberOfElements){
+            const size_t count = min(batchSize, numberOfElements - next);
+            for (size_t i=0; i<count; i++){
+                batch[i] = (double)(next + i);
+            }
+            size_t enqueued = 0;
+            while (enqueued < count){
+                enqueued += enqueue(queue, batch.data() + enqueued, count - enqueued);
+            }
+            next += count;
+        }
+    });
+
+    vector< double > batch(batchSize);
+    size_t next = 0;
+    while (next < numberOfElements){
+        const size_t count = dequeue(queue, batch.data(), batchSize);
+        for (size_t i=0; i<count; i++){
+            if (batch[i] != (double)(next + i)){
+                throw WrongOrderException();
+            }
+        }
+        next += count;
+    }
+    producer.join();
+    high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+    return numberOfElements / duration<double>(t1 - t0).count();
+}
+
+void QueueBenchmark::run(){
+    const size_t numberOfElements = 20000000;
+    const bool multiCore = thread::hardware_concurrency() > 1;
+    cout << fixed << setprecision(1);
+
+    for (size_t capacity : { 100, 1000, 10000 }){
+        for (size_t batchSize : { 1, 8, 64, 512 }){
+            const string mode = (batchSize == 1) ? string("one by one") : "batches of " + to_string(batchSize);
+            cout << "capacity " << setw(5) << capacity << ", " << setw(14) << left << mode << right
+                 << " : one thread " << setw(7) << measureSingleThread(numberOfElements, capacity, batchSize) / 1e6 << " M/s";
+            if (multiCore){
+                cout << ", two threads " << setw(7) << measureTwoThreads(numberOfElements, capacity, batchSize) / 1e6 << " M/s";
+            }
+            cout << endl;
+        }
+    }
+}
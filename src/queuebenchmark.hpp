@@ -0,0 +1,25 @@
+#ifndef QUEUE_BENCHMARK_HPP
+#define QUEUE_BENCHMARK_HPP
+
+#include <cstddef>
+#include <exception>
+
+
+// Throughput of the ReaderWriterQueue, moving the elements one at a time
+// or in batches :
+//  - on one thread, filling the queue then draining it, which measures the
+//    cost of the calls themselves,
+//  - between two threads, which adds the cache traffic between the cores
+//    (skipped on single core machines, where it measures the scheduler).
+class QueueBenchmark {
+public:
+    void run();
+private:
+    class WrongOrderException : std::exception {};
+
+    double measureSingleThread(size_t numberOfElements, size_t capacity, size_t batchSize);
+    double measureTwoThreads(size_t numberOfElements, size_t capacity, size_t batchSize);
+};
+
+
+#endif
@@ -409,6 +409,85 @@ public:
         return true;
     }
 
+    // Enqueues copies of the first count elements of the array, as many as
+    // there is room for, and returns how many were enqueued.
+    // Does not allocate memory. The elements are published block by block,
+    // with one acquire and one release fence per block instead of a pair
+    // per element.
+    size_t try_enqueue_bulk(T const* elements, size_t count)
+    {
+#ifndef NDEBUG
+        ReentrantGuard guard(this->enqueuing);
+#endif
+
+        Block* tailBlock_ = tailBlock.load();
+        size_t enqueued = fill_block(tailBlock_, elements, count);
+
+        while (enqueued < count) {
+            // tailBlock is full, see inner_enqueue for the reasoning
+            fence(memory_order_acquire);
+            if (tailBlock_->next.load() == frontBlock) {
+                // Would have had to allocate a new block
+                break;
+            }
+
+            fence(memory_order_acquire);
+            Block* tailBlockNext = tailBlock_->next.load();
+            tailBlockNext->localFront = tailBlockNext->front.load();
+            fence(memory_order_acquire);
+            assert(tailBlockNext->localFront == tailBlockNext->tail.load());
+
+            // Fill the next block before advancing to it, the consumer
+            // expects any block past the front one to be non-empty
+            enqueued += fill_block(tailBlockNext, elements + enqueued, count - enqueued);
+
+            fence(memory_order_release);
+            tailBlock = tailBlock_ = tailBlockNext;
+        }
+
+        return enqueued;
+    }
+
+    // Moves up to maxCount elements from the front of the queue to the
+    // contiguous storage pointed to by results, using operator=, and
+    // returns how many were dequeued. One acquire and one release fence
+    // per block instead of a pair per element.
+    size_t try_dequeue_bulk(T* results, size_t maxCount)
+    {
+#ifndef NDEBUG
+        ReentrantGuard guard(this->dequeuing);
+#endif
+
+        Block* frontBlock_ = frontBlock.load();
+        size_t dequeued = 0;
+
+        while (dequeued < maxCount) {
+            dequeued += drain_block(frontBlock_, results + dequeued, maxCount - dequeued);
+            if (dequeued == maxCount || frontBlock_ == tailBlock.load()) {
+                break;
+            }
+
+            // Same double check as try_dequeue : the producer may have
+            // filled the front block and moved on since we found it empty
+            fence(memory_order_acquire);
+            size_t blockTail = frontBlock_->localTail = frontBlock_->tail.load();
+            size_t blockFront = frontBlock_->front.load();
+            fence(memory_order_acquire);
+            if (blockFront != blockTail) {
+                continue;
+            }
+
+            // Front block is empty but there's another block ahead, advance to it
+            Block* nextBlock = frontBlock_->next;
+            fence(memory_order_release);
+            frontBlock = frontBlock_ = nextBlock;
+            compiler_fence(memory_order_release);
+        }
+
+        return dequeued;
+    }
+
+
     // Returns the approximate number of items currently in the queue.
     // Safe to call from both the producer and consumer threads.
     inline size_t size_approx() const
@@ -625,6 +704,60 @@ private:
         return new (newBlockAligned) Block(capacity, newBlockRaw, newBlockData);
     }
 
+    // Copies as many of the count elements as fit in the block after its
+    // tail, then publishes them at once. Producer only.
+    size_t fill_block(Block* block, T const* elements, size_t count)
+    {
+        size_t blockTail = block->tail.load();
+        size_t room = (block->localFront - blockTail - 1) & block->sizeMask;
+        if (room < count) {
+            block->localFront = block->front.load();
+            room = (block->localFront - blockTail - 1) & block->sizeMask;
+        }
+        fence(memory_order_acquire);
+
+        const size_t filled = room < count ? room : count;
+        if (filled == 0) {
+            return 0;
+        }
+        for (size_t i = 0; i != filled; ++i) {
+            new (block->data + blockTail * sizeof(T)) T(elements[i]);
+            blockTail = (blockTail + 1) & block->sizeMask;
+        }
+
+        fence(memory_order_release);
+        block->tail = blockTail;
+        return filled;
+    }
+
+    // Moves up to maxCount elements from the front of the block, then
+    // hands their slots back to the producer at once. Consumer only.
+    size_t drain_block(Block* block, T* results, size_t maxCount)
+    {
+        size_t blockFront = block->front.load();
+        size_t available = (block->localTail - blockFront) & block->sizeMask;
+        if (available < maxCount) {
+            block->localTail = block->tail.load();
+            available = (block->localTail - blockFront) & block->sizeMask;
+        }
+        fence(memory_order_acquire);
+
+        const size_t drained = available < maxCount ? available : maxCount;
+        if (drained == 0) {
+            return 0;
+        }
+        for (size_t i = 0; i != drained; ++i) {
+            auto element = reinterpret_cast<T*>(block->data + blockFront * sizeof(T));
+            results[i] = std::move(*element);
+            element->~T();
+            blockFront = (blockFront + 1) & block->sizeMask;
+        }
+
+        fence(memory_order_release);
+        block->front = blockFront;
+        return drained;
+    }
+
 private:
     weak_atomic<Block*> frontBlock;     // (Atomic) Elements are enqueued to this block
 
@@ -1,9 +1,33 @@
+#ifndef RW_QUEUE_TYPE_HPP
+#define RW_QUEUE_TYPE_HPP
+
 #include "readerwriterqueue.h"
 #include "atomicops.h"
 
 #include <vector>
 
-typedef moodycamel::ReaderWriterQueue<double> RWQueue;
+#include "instrumentedqueue.hpp"
+#include "triplebuffer.hpp"
+#include "analysisframe.hpp"
+#include "spectrogramrow.hpp"
+
+// Building with -DVUMETER_QUEUE_STATS swaps the queues for instrumented
+// ones, whose getStatistics() tells how full they get and how long the
+// elements wait in them.
+#ifdef VUMETER_QUEUE_STATS
+template <typename T> using RWQueueOf = InstrumentedQueue<T>;
+#else
+template <typename T> using RWQueueOf = moodycamel::ReaderWriterQueue<T>;
+#endif
+
+typedef RWQueueOf<double> RWQueue;
+
+// Latest analysis from the analysis thread to the GUI thread
+typedef TripleBuffer<AnalysisFrame> AnalysisFeed;
 
-typedef moodycamel::ReaderWriterQueue<std::vector<double>> RWVectorQueue;
+// Every row of the spectrogram, from the analysis thread to the GUI thread:
+// unlike the AnalysisFeed, none is skipped when the display refreshes less
+// often than the hops come.
+typedef RWQueueOf<SpectrogramRow> SpectrogramFeed;
 
+#endif
@@ -0,0 +1,50 @@
+#include "samplering.hpp"
+
+using namespace std;
+
+
+// One per callback : enough for a ring of a few seconds.
+const size_t MAX_NUMBER_OF_TIMESTAMPS = 1024;
+
+static float *alignToCacheLine(vector< float > &storage, size_t cacheLineSize){
+    const uintptr_t address = (uintptr_t)storage.data();
+    return (float *)((address + cacheLineSize - 1) & ~(uintptr_t)(cacheLineSize - 1));
+}
+
+static size_t roundUpToPowerOfTwo(size_t val){
+    size_t result = 1;
+    while (result < val){
+        result <<= 1;
+    }
+    return result;
+}
+
+SampleRing::SampleRing(double seconds, double sampleRate, size_t maxNumberOfChannels) :
+    m_producer(),
+    m_consumer(),
+    m_storage(roundUpToPowerOfTwo((size_t)(seconds * sampleRate) * maxNumberOfChannels)
+              + CACHE_LINE_SIZE / sizeof(float)),
+    m_samples(alignToCacheLine(m_storage, CACHE_LINE_SIZE)),
+    m_mask(m_storage.size() - CACHE_LINE_SIZE / sizeof(float) - 1),
+    m_numberOfChannels(0),
+    m_closed(false),
+    m_timestamps(MAX_NUMBER_OF_TIMESTAMPS),
+    m_dataAvailable()
+{
+    m_producer.writeCount.store(0);
+    m_producer.cachedReadCount = 0;
+    m_producer.inputOverflows.store(0);
+    m_producer.inputUnderflows.store(0);
+    m_producer.ringFullEvents.store(0);
+    m_producer.droppedFrames.store(0);
+    m_consumer.readCount.store(0);
+}
+
+SampleRingStatistics SampleRing::getStatistics() const {
+    SampleRingStatistics statistics;
+    statistics.inputOverflows = m_producer.inputOverflows.load(memory_order_relaxed);
+    statistics.inputUnderflows = m_producer.inputUnderflows.load(memory_order_relaxed);
+    statistics.ringFullEvents = m_producer.ringFullEvents.load(memory_order_relaxed);
+    statistics.droppedFrames = m_producer.droppedFrames.load(memory_order_relaxed);
+    return statistics;
+}
@@ -0,0 +1,243 @@
+#ifndef SAMPLE_RING_HPP
+#define SAMPLE_RING_HPP
+
+#include "rwqueuetype.hpp"
+#include "atomicops.h"
+
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+
+// Counters kept by the producer of a SampleRing, to tell whether anything
+// was lost between the sound card and the analysis.
+struct SampleRingStatistics {
+    uint64_t inputOverflows;    // callbacks flagged paInputOverflow : the card dropped input
+    uint64_t inputUnderflows;   // callbacks flagged paInputUnderflow
+    uint64_t ringFullEvents;    // writes that did not fit entirely in the ring
+    uint64_t droppedFrames;     // frames lost by those writes
+};
+
+// When the first sample of a write was captured, on the clock of the stream
+// and on the steady clock.
+struct SampleTimestamp {
+    size_t sampleCount;     // number of samples written before that one
+    double adcTime;
+    std::chrono::steady_clock::time_point captureTime;
+};
+
+// Contiguous samples inside the ring.
+struct SampleSpan {
+    const float *samples;
+    size_t count;
+};
+
+
+// Ring of raw interleaved samples between the PortAudio callback (the
+// single producer) and the analysis thread (the single consumer).
+// write and read are wait-free: each side only loads the counter of the
+// other one and stores its own. The counters grow forever and, the
+// capacity being a power of two, the position in the ring is a mask of
+// them. The counters of each side live on their own cache line, and the
+// producer keeps the last read counter it saw, so that the audio thread
+// only touches the consumer's line when the ring looks full.
+// The producer also wakes the consumer through a lightweight semaphore,
+// which only enters the kernel when the consumer is actually sleeping.
+// The consumer can process the samples in place, through at most two spans
+// (before and after the end of the ring), then release them.
+// Each timed write also leaves its timestamp in a small preallocated queue,
+// from which the consumer can date any sample it reads.
+class SampleRing {
+public:
+    // The capacity is rounded up to the next power of two.
+    explicit SampleRing(double seconds, double sampleRate, size_t maxNumberOfChannels);
+
+    // Producer, before the first write. The consumer waits for it to know
+    // how the samples are interleaved.
+    void setNumberOfChannels(size_t numberOfChannels){
+        m_numberOfChannels.store(numberOfChannels, std::memory_order_release);
+    }
+    size_t getNumberOfChannels() const {
+        return m_numberOfChannels.load(std::memory_order_acquire);
+    }
+
+    // Producer. Copies as many of the count samples as there is room for,
+    // in whole frames, and returns that number; the others are counted as
+    // dropped. Before setNumberOfChannels, nothing is written.
+    size_t write(const float *samples, size_t count){
+        const size_t numberOfChannels = m_numberOfChannels.load(std::memory_order_relaxed);
+        if (numberOfChannels == 0){
+            return 0;
+        }
+        const size_t writeCount = m_producer.writeCount.load(std::memory_order_relaxed);
+        if (m_mask + 1 - (writeCount - m_producer.cachedReadCount) < count){
+            m_producer.cachedReadCount = m_consumer.readCount.load(std::memory_order_acquire);
+        }
+        size_t written = std::min(count, m_mask + 1 - (writeCount - m_producer.cachedReadCount));
+        written -= written % numberOfChannels;
+
+        const size_t position = writeCount & m_mask;
+        const size_t firstSpan = std::min(written, m_mask + 1 - position);
+        std::copy(samples, samples + firstSpan, &m_samples[position]);
+        std::copy(samples + firstSpan, samples + written, &m_samples[0]);
+        m_producer.writeCount.store(writeCount + written, std::memory_order_release);
+
+        if (written < count){
+            increment(m_producer.ringFullEvents, 1);
+            increment(m_producer.droppedFrames, (count - written) / numberOfChannels);
+        }
+        m_dataAvailable.signal();
+        return written;
+    }
+
+    // Producer. Same as above, and dates the first written sample.
+    size_t write(const float *samples, size_t count,
+                 double adcTime, std::chrono::steady_clock::time_point captureTime){
+        const size_t sampleCount = m_producer.writeCount.load(std::memory_order_relaxed);
+        const size_t written = write(samples, count);
+        if (written > 0){
+            // when it is full, the consumer extrapolates from an older one
+            m_timestamps.try_enqueue(SampleTimestamp{ sampleCount, adcTime, captureTime });
+        }
+        return written;
+    }
+
+    // Producer. Room left in the ring, in samples: a write of that many
+    // samples would not drop any.
+    size_t getFreeSpace(){
+        m_producer.cachedReadCount = m_consumer.readCount.load(std::memory_order_acquire);
+        return m_mask + 1 - (m_producer.writeCount.load(std::memory_order_relaxed) - m_producer.cachedReadCount);
+    }
+
+    // Producer, after its last write: the consumer can tell the end of a
+    // file from a pause of the input.
+    void close(){
+        m_closed.store(true, std::memory_order_release);
+        m_dataAvailable.signal();
+    }
+
+    // Producer, from the status flags of the callback.
+    void countInputOverflow(){
+        increment(m_producer.inputOverflows, 1);
+    }
+    void countInputUnderflow(){
+        increment(m_producer.inputUnderflows, 1);
+    }
+
+    // Consumer. The samples written and not released yet, oldest first, in
+    // one span or in two when they wrap around the end of the ring. Returns
+    // their total, which is whole frames. With one, two or any power of two
+    // channels, each span holds whole frames too; otherwise the frame that
+    // wraps around is cut between the two spans.
+    size_t peek(SampleSpan &first, SampleSpan &second){
+        const size_t readCount = m_consumer.readCount.load(std::memory_order_relaxed);
+        const size_t available = m_producer.writeCount.load(std::memory_order_acquire) - readCount;
+
+        const size_t position = readCount & m_mask;
+        first.samples = &m_samples[position];
+        first.count = std::min(available, m_mask + 1 - position);
+        second.samples = &m_samples[0];
+        second.count = available - first.count;
+        return available;
+    }
+
+    // Consumer. True once the producer is done: if it was true before a
+    // peek, what that peek returns is all that is left.
+    bool isClosed() const {
+        return m_closed.load(std::memory_order_acquire);
+    }
+
+    // Consumer. Number of samples released so far, which is also the
+    // sampleCount of the first span returned by peek.
+    size_t getReadCount() const {
+        return m_consumer.readCount.load(std::memory_order_relaxed);
+    }
+
+    // Consumer. The oldest timestamp not popped yet, or nullptr.
+    SampleTimestamp *peekTimestamp(){
+        return m_timestamps.peek();
+    }
+    void popTimestamp(){
+        m_timestamps.pop();
+    }
+
+    // Consumer. Gives the count oldest samples back to the producer.
+    void release(size_t count){
+        m_consumer.readCount.store(m_consumer.readCount.load(std::memory_order_relaxed) + count,
+                                   std::memory_order_release);
+    }
+
+    // Consumer. Copies up to count samples out of the ring and returns
+    // that number.
+    size_t read(float *samples, size_t count){
+        SampleSpan first, second;
+        const size_t numberRead = std::min(count, peek(first, second));
+        const size_t firstSpan = std::min(numberRead, first.count);
+        std::copy(first.samples, first.samples + firstSpan, samples);
+        std::copy(second.samples, second.samples + numberRead - firstSpan, samples + firstSpan);
+        release(numberRead);
+        return numberRead;
+    }
+
+    // Consumer. Number of samples written and not released yet.
+    size_t available() const {
+        return m_producer.writeCount.load(std::memory_order_acquire) - m_consumer.readCount.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return m_mask + 1;
+    }
+
+    // Any thread.
+    SampleRingStatistics getStatistics() const;
+#ifdef VUMETER_QUEUE_STATS
+    QueueStatistics getTimestampQueueStatistics() const {
+        return m_timestamps.getStatistics();
+    }
+#endif
+
+    // Consumer. Sleeps until the producer writes again, or timeoutUsecs.
+    void waitForData(std::int64_t timeoutUsecs){
+        m_dataAvailable.wait(timeoutUsecs);
+    }
+
+private:
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    // Only the producer writes these.
+    struct alignas(CACHE_LINE_SIZE) ProducerSide {
+        std::atomic< size_t > writeCount;
+        size_t cachedReadCount;
+        std::atomic< uint64_t > inputOverflows;
+        std::atomic< uint64_t > inputUnderflows;
+        std::atomic< uint64_t > ringFullEvents;
+        std::atomic< uint64_t > droppedFrames;
+    };
+
+    // Only the consumer writes this.
+    struct alignas(CACHE_LINE_SIZE) ConsumerSide {
+        std::atomic< size_t > readCount;
+    };
+
+    ProducerSide m_producer;
+    ConsumerSide m_consumer;
+    // m_samples is m_storage rounded up to a cache line: the ring starts on
+    // a line of its own, away from the counters
+    std::vector< float > m_storage;
+    float *m_samples;
+    size_t m_mask;
+    std::atomic< size_t > m_numberOfChannels;
+    std::atomic< bool > m_closed;
+    RWQueueOf< SampleTimestamp > m_timestamps;
+    moodycamel::spsc_sema::LightweightSemaphore m_dataAvailable;
+
+    // A single writer : no need for an atomic read-modify-write.
+    static void increment(std::atomic< uint64_t > &counter, uint64_t value){
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "scope.hpp"
+
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+
+// A cell hit that many times, after fading, is drawn at half brightness.
+const float HALF_BRIGHTNESS_HITS = 4.0f;
+
+
+Scope::Scope(double sampleRate, double waveformSeconds, double persistenceSeconds) :
+    m_samplesPerColumn(max((size_t)1, (size_t)lround(sampleRate * waveformSeconds / ScopeFrame::NUMBER_OF_COLUMNS))),
+    m_persistenceFrames(sampleRate * persistenceSeconds),
+    m_numberOfChannels(1),
+    m_samplesInColumn(0),
+    m_minimum(ScopeFrame::MAX_NUMBER_OF_CHANNELS * ScopeFrame::NUMBER_OF_COLUMNS, 0.0f),
+    m_maximum(ScopeFrame::MAX_NUMBER_OF_CHANNELS * ScopeFrame::NUMBER_OF_COLUMNS, 0.0f),
+    m_oldestColumn(0),
+    m_hits(ScopeFrame::GONIOMETER_SIZE * ScopeFrame::GONIOMETER_SIZE, 0.0f),
+    m_framesSinceFill(0)
+{
+    resetColumn();
+}
+
+void Scope::resetColumn(){
+    m_samplesInColumn = 0;
+    for (size_t channel=0; channel<ScopeFrame::MAX_NUMBER_OF_CHANNELS; channel++){
+        m_columnMinimum[channel] = INFINITY;
+        m_columnMaximum[channel] = -INFINITY;
+    }
+}
+
+void Scope::completeColumn(){
+    for (size_t channel=0; channel<m_numberOfChannels; channel++){
+        m_minimum[channel * ScopeFrame::NUMBER_OF_COLUMNS + m_oldestColumn] = m_columnMinimum[channel];
+        m_maximum[channel * ScopeFrame::NUMBER_OF_COLUMNS + m_oldestColumn] = m_columnMaximum[channel];
+    }
+    m_oldestColumn = (m_oldestColumn + 1) % ScopeFrame::NUMBER_OF_COLUMNS;
+    resetColumn();
+}
+
+void Scope::fill(ScopeFrame &scopeFrame){
+    const size_t numberOfColumns = ScopeFrame::NUMBER_OF_COLUMNS;
+    const size_t newestColumns = numberOfColumns - m_oldestColumn;
+
+    scopeFrame.numberOfChannels = m_numberOfChannels;
+    for (size_t channel=0; channel<m_numberOfChannels; channel++){
+        const float *minimum = &m_minimum[channel * numberOfColumns];
+        const float *maximum = &m_maximum[channel * numberOfColumns];
+        memcpy(scopeFrame.minimum[channel], minimum + m_oldestColumn, newestColumns * sizeof(float));
+        memcpy(scopeFrame.minimum[channel] + newestColumns, minimum, m_oldestColumn * sizeof(float));
+        memcpy(scopeFrame.maximum[channel], maximum + m_oldestColumn, newestColumns * sizeof(float));
+        memcpy(scopeFrame.maximum[channel] + newestColumns, maximum, m_oldestColumn * sizeof(float));
+    }
+
+    // the fading is applied here, once per frame, rather than per sample
+    const float fading = (float)exp(-(double)m_framesSinceFill / m_persistenceFrames);
+    m_framesSinceFill = 0;
+    for (size_t cell=0; cell<m_hits.size(); cell++){
+        const float hits = (m_hits[cell] *= fading);
+        scopeFrame.goniometer[cell] = (uint8_t)(255.0f * hits / (hits + HALF_BRIGHTNESS_HITS));
+    }
+}
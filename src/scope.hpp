@@ -0,0 +1,77 @@
+#ifndef SCOPE_HPP
+#define SCOPE_HPP
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "scopeframe.hpp"
+
+
+// Reduces the raw samples to what the oscilloscope and the goniometer
+// draw, on the analysis thread, so that the display never sees the
+// samples themselves.
+// The waveform covers the latest waveformSeconds of audio: every column
+// keeps the minimum and the maximum of its samples, and the columns are a
+// ring completed one at a time, nothing is shifted.
+// For the goniometer, every sample hits one cell of a point cloud, and the
+// hits fade out with a time constant of persistenceSeconds.
+class Scope {
+public:
+    explicit Scope(double sampleRate, double waveformSeconds, double persistenceSeconds);
+
+    // Adds one sample per channel, numberOfChannels of them; only the first
+    // two are drawn. A mono input is drawn as identical left and right
+    // channels on the goniometer.
+    void addFrame(const float *samples, size_t numberOfChannels){
+        m_numberOfChannels = (numberOfChannels < ScopeFrame::MAX_NUMBER_OF_CHANNELS) ?
+            numberOfChannels : ScopeFrame::MAX_NUMBER_OF_CHANNELS;
+        for (size_t channel=0; channel<m_numberOfChannels; channel++){
+            m_columnMinimum[channel] = std::min(m_columnMinimum[channel], samples[channel]);
+            m_columnMaximum[channel] = std::max(m_columnMaximum[channel], samples[channel]);
+        }
+        const float left = samples[0];
+        const float right = (numberOfChannels > 1) ? samples[1] : left;
+        m_hits[getCell(0.5f * (left - right), 0.5f * (left + right))] += 1.0f;
+        m_framesSinceFill++;
+
+        if (++m_samplesInColumn == m_samplesPerColumn){
+            completeColumn();
+        }
+    }
+
+    // Writes the completed columns and the faded point cloud.
+    void fill(ScopeFrame &scopeFrame);
+
+    size_t getSamplesPerColumn() const { return m_samplesPerColumn; }
+
+private:
+    size_t m_samplesPerColumn;
+    double m_persistenceFrames;
+    size_t m_numberOfChannels;
+
+    // the column being accumulated
+    size_t m_samplesInColumn;
+    float m_columnMinimum[ScopeFrame::MAX_NUMBER_OF_CHANNELS];
+    float m_columnMaximum[ScopeFrame::MAX_NUMBER_OF_CHANNELS];
+
+    // the completed columns of each channel, the oldest at m_oldestColumn
+    std::vector< float > m_minimum;
+    std::vector< float > m_maximum;
+    size_t m_oldestColumn;
+
+    std::vector< float > m_hits;   // faded number of hits of each cell
+    size_t m_framesSinceFill;
+
+    static size_t getCell(float side, float mid){
+        const int size = (int)ScopeFrame::GONIOMETER_SIZE;
+        const int x = std::max(0, std::min(size - 1, (int)((side + 1.0f) * 0.5f * size)));
+        const int y = std::max(0, std::min(size - 1, (int)((1.0f - mid) * 0.5f * size)));
+        return (size_t)(y * size + x);
+    }
+
+    void completeColumn();
+    void resetColumn();
+};
+
+#endif
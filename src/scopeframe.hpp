@@ -0,0 +1,28 @@
+#ifndef SCOPE_FRAME_HPP
+#define SCOPE_FRAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+// What the oscilloscope and the goniometer draw, already reduced to the
+// resolution of the screen: drawing it costs the same whatever the sample
+// rate. The layout is fixed, so the frame is filled in place.
+struct ScopeFrame {
+    static const size_t MAX_NUMBER_OF_CHANNELS = 2;
+    static const size_t NUMBER_OF_COLUMNS = 320;   // one per pixel of the waveform view
+    static const size_t GONIOMETER_SIZE = 128;     // cells on each side of the point cloud
+
+    size_t numberOfChannels = 1;
+
+    // smallest and largest sample of each column of the waveform, the
+    // oldest column first
+    float minimum[MAX_NUMBER_OF_CHANNELS][NUMBER_OF_COLUMNS] = {};
+    float maximum[MAX_NUMBER_OF_CHANNELS][NUMBER_OF_COLUMNS] = {};
+
+    // brightness of each cell of the point cloud, row by row from the top:
+    // side (L-R)/2 from left to right, mid (L+R)/2 from bottom to top
+    uint8_t goniometer[GONIOMETER_SIZE * GONIOMETER_SIZE] = {};
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "signalgenerator.hpp"
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+
+const float AMPLITUDE = 0.5f;
+const unsigned NOISE_SEED = 3;
+const double SWEEP_LOWEST_FREQUENCY = 20.0;
+const double SWEEP_SECONDS = 10.0;
+
+
+SignalGenerator::SignalGenerator(SignalType signalType,
+                                 double sampleRate,
+                                 size_t numberOfChannels,
+                                 double frequency,
+                                 double seconds,
+                                 Pacing pacing) :
+    BlockAudioSource(pacing),
+    m_signalType(signalType),
+    m_sampleRate(sampleRate),
+    m_numberOfChannels(numberOfChannels),
+    m_frequency(frequency),
+    m_numberOfFrames((uint64_t)llround(seconds * sampleRate)),
+    m_nextFrame(0),
+    m_phase(0.0),
+    m_random(NOISE_SEED)
+{
+}
+
+float SignalGenerator::nextSample(){
+    double frequency = m_frequency;
+    switch (m_signalType){
+    case SignalType::noise:
+        // not uniform_real_distribution, whose algorithm is left to the library
+        return AMPLITUDE * (float)(2.0 * (m_random() - minstd_rand::min()) / (minstd_rand::max() - minstd_rand::min()) - 1.0);
+    case SignalType::sweep: {
+        // the same number of seconds per octave
+        const double highestFrequency = 0.45 * m_sampleRate;
+        const double position = fmod((double)m_nextFrame / m_sampleRate, SWEEP_SECONDS) / SWEEP_SECONDS;
+        frequency = SWEEP_LOWEST_FREQUENCY * pow(highestFrequency / SWEEP_LOWEST_FREQUENCY, position);
+        break;
+    }
+    case SignalType::sine:
+        break;
+    }
+    // the phase is accumulated, so that the frequency can change smoothly
+    const float sample = AMPLITUDE * (float)sin(2.0 * M_PI * m_phase);
+    m_phase += frequency / m_sampleRate;
+    m_phase -= floor(m_phase);
+    return sample;
+}
+
+size_t SignalGenerator::readFrames(float *samples, size_t numberOfFrames){
+    if (m_numberOfFrames > 0){
+        numberOfFrames = (size_t)min((uint64_t)numberOfFrames, m_numberOfFrames - m_nextFrame);
+    }
+    for (size_t frame=0; frame<numberOfFrames; frame++){
+        const float sample = nextSample();
+        for (size_t channel=0; channel<m_numberOfChannels; channel++){
+            *samples++ = sample;
+        }
+        m_nextFrame++;
+    }
+    return numberOfFrames;
+}
@@ -0,0 +1,49 @@
+#ifndef SIGNAL_GENERATOR_HPP
+#define SIGNAL_GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+#include "audiosource.hpp"
+
+
+enum class SignalType {
+    sine,    // at the given frequency
+    noise,   // white, uniform
+    sweep    // logarithmic, from 20 Hz to 90% of the Nyquist frequency, repeated
+};
+
+// Synthetic input, the same samples on every run and every platform: the
+// noise comes from minstd_rand, whose sequence the standard specifies,
+// with a fixed seed. Every channel carries the same signal, at
+// half of the full scale.
+class SignalGenerator : public BlockAudioSource {
+public:
+    explicit SignalGenerator(SignalType signalType,
+                             double sampleRate,
+                             size_t numberOfChannels,
+                             double frequency,
+                             double seconds,      // 0 for never ending
+                             Pacing pacing);
+
+    double getSampleRate() const override { return m_sampleRate; }
+
+protected:
+    size_t getNumberOfChannels() const override { return m_numberOfChannels; }
+    size_t readFrames(float *samples, size_t numberOfFrames) override;
+
+private:
+    SignalType m_signalType;
+    double m_sampleRate;
+    size_t m_numberOfChannels;
+    double m_frequency;
+    uint64_t m_numberOfFrames;   // 0 for never ending
+    uint64_t m_nextFrame;
+    double m_phase;              // in turns
+    std::minstd_rand m_random;
+
+    float nextSample();
+};
+
+#endif
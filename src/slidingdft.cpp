@@ -0,0 +1,45 @@
+#include "slidingdft.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+
+SlidingDFT::SlidingDFT(size_t windowSize, const vector< size_t > &bins) :
+    m_history(windowSize, 0.0f),
+    m_writeIndex(0),
+    m_rotations(),
+    m_bins(bins.size()),
+    m_peakNorms(bins.size(), 0.0),
+    m_frequentialAmplitudes(bins.size())
+{
+    static const double pi = std::acos(-1);
+    for (size_t bin : bins){
+        m_rotations.push_back(polar(1.0, -2.0 * pi * (double)(bin % windowSize) / (double)windowSize));
+    }
+}
+
+const vector< float > &SlidingDFT::computeFrequentialAmplitudes(){
+    for (size_t i=0; i<m_bins.size(); i++){
+        m_frequentialAmplitudes[i] = (float)abs(m_bins[i]);
+    }
+    return m_frequentialAmplitudes;
+}
+
+void SlidingDFT::addSamples(const float *samples, size_t count){
+    for (size_t i=0; i<count; i++){
+        addSample(samples[i]);
+        for (size_t bin=0; bin<m_bins.size(); bin++){
+            m_peakNorms[bin] = max(m_peakNorms[bin], norm(m_bins[bin]));
+        }
+    }
+}
+
+const vector< float > &SlidingDFT::computePeakAmplitudes(){
+    for (size_t i=0; i<m_bins.size(); i++){
+        m_frequentialAmplitudes[i] = (float)sqrt(m_peakNorms[i]);
+        m_peakNorms[i] = 0.0;
+    }
+    return m_frequentialAmplitudes;
+}
@@ -0,0 +1,57 @@
+#ifndef SLIDING_DFT_HPP
+#define SLIDING_DFT_HPP
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+
+
+// Sliding DFT for a handful of monitored bins. Each sample updates every
+// monitored bin in O(1), so their amplitudes follow the signal sample by
+// sample instead of once per block:
+//   S_k(n) = (S_k(n-1) - x[n-N] + x[n]) * omega^-k
+// S_k(n) is the bin k of the transform of the latest N samples, the same
+// value as FFT/RealFFT would give for that window (rectangular, not
+// normalized). The accumulators are kept in double precision so that the
+// recursion does not drift over hours of audio.
+class SlidingDFT {
+public:
+    explicit SlidingDFT(size_t windowSize, const std::vector< size_t > &bins);
+
+    void addSample(float sample){
+        const double oldest = m_history[m_writeIndex];
+        m_history[m_writeIndex] = sample;
+        if (++m_writeIndex == m_history.size()){
+            m_writeIndex = 0;
+        }
+
+        const double delta = (double)sample - oldest;
+        for (size_t i=0; i<m_bins.size(); i++){
+            const std::complex< double > s = m_bins[i] + delta;
+            const std::complex< double > &w = m_rotations[i];
+            m_bins[i] = std::complex< double >(s.real()*w.real() - s.imag()*w.imag(),
+                                               s.real()*w.imag() + s.imag()*w.real());
+        }
+    }
+
+    // Same as addSample for count samples, and keeps the largest amplitude
+    // each bin reaches on the way.
+    void addSamples(const float *samples, size_t count);
+
+    // One amplitude per monitored bin, in the order given to the constructor.
+    const std::vector< float > &computeFrequentialAmplitudes();
+
+    // Same layout, the largest amplitude of each bin over the samples given
+    // to addSamples since the previous call.
+    const std::vector< float > &computePeakAmplitudes();
+
+private:
+    std::vector< float > m_history;
+    size_t m_writeIndex;
+    std::vector< std::complex< double > > m_rotations;   // omega^-k of each bin
+    std::vector< std::complex< double > > m_bins;
+    std::vector< double > m_peakNorms;   // squared amplitudes
+    std::vector< float > m_frequentialAmplitudes;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef SPECTROGRAM_ROW_HPP
+#define SPECTROGRAM_ROW_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+// One row of the spectrogram, quantized by the analysis at every hop: the
+// mean power of the channels in each bin, in dB steps above FLOOR_DB, from
+// 0 (the floor or below) to -FLOOR_DB (a full scale sine). The layout is
+// fixed, so that the rows go through a preallocated queue without any
+// allocation.
+struct SpectrogramRow {
+    static const int FLOOR_DB = -96;
+    static const size_t MAX_NUMBER_OF_BINS = 513;   // frames of up to 1024 samples
+
+    size_t numberOfBins = 0;
+    uint8_t steps[MAX_NUMBER_OF_BINS] = {};
+};
+
+#endif
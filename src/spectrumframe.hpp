@@ -0,0 +1,27 @@
+#ifndef SPECTRUM_FRAME_HPP
+#define SPECTRUM_FRAME_HPP
+
+#include <vector>
+#include <cstddef>
+
+
+// Amplitude spectra of one analysis frame, N/2+1 bins per channel.
+// Only the first numberOfChannels channels are meaningful. The mid and side
+// spectra are those of the first two channels, taken as left and right.
+struct SpectrumFrame {
+    SpectrumFrame() {}
+
+    // Every channel allocated, whatever the input turns out to be.
+    explicit SpectrumFrame(size_t numberOfBins, size_t maxNumberOfChannels) :
+        channels(maxNumberOfChannels, std::vector< float >(numberOfBins)),
+        mid(maxNumberOfChannels >= 2 ? numberOfBins : 0),
+        side(maxNumberOfChannels >= 2 ? numberOfBins : 0)
+    {}
+
+    size_t numberOfChannels = 1;
+    std::vector< std::vector< float > > channels;
+    std::vector< float > mid;     // (left + right) / 2
+    std::vector< float > side;    // (left - right) / 2
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "stft.hpp"
+
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+using namespace std;
+
+
+// Cosine-sum windows : w[n] = a0 - a1*cos(x) + a2*cos(2x) - a3*cos(3x) + a4*cos(4x)
+// with x = 2*pi*n/size.
+vector< float > computeWindow(WindowType windowType, size_t size){
+    static const double pi = std::acos(-1);
+    double coefs[5] = { 1.0, 0.0, 0.0, 0.0, 0.0 };
+
+    switch (windowType){
+    case WindowType::rectangular:
+        break;
+    case WindowType::hann:
+        coefs[0] = 0.5;
+        coefs[1] = 0.5;
+        break;
+    case WindowType::blackmanHarris:
+        coefs[0] = 0.35875;
+        coefs[1] = 0.48829;
+        coefs[2] = 0.14128;
+        coefs[3] = 0.01168;
+        break;
+    case WindowType::flatTop:
+        coefs[0] = 0.21557895;
+        coefs[1] = 0.41663158;
+        coefs[2] = 0.277263158;
+        coefs[3] = 0.083578947;
+        coefs[4] = 0.006947368;
+        break;
+    }
+
+    vector< double > window(size);
+    for (size_t n=0; n<size; n++){
+        const double x = 2.0 * pi * (double)n / (double)size;
+        window[n] = coefs[0] - coefs[1]*cos(x) + coefs[2]*cos(2*x) - coefs[3]*cos(3*x) + coefs[4]*cos(4*x);
+    }
+
+    const double sum = accumulate(window.begin(), window.end(), 0.0);
+    vector< float > scaledWindow(size);
+    for (size_t n=0; n<size; n++){
+        scaledWindow[n] = (float)(window[n] * (double)size / sum);
+    }
+    return scaledWindow;
+}
+
+
+STFT::STFT(size_t frameSize, size_t hopSize, WindowType windowType, size_t numberOfChannels) :
+    m_numberOfChannels(numberOfChannels),
+    m_hopSize(hopSize),
+    m_window(computeWindow(windowType, frameSize)),
+    m_history(frameSize * numberOfChannels, 0.0f),
+    m_writeIndex(0),
+    m_samplesSinceLastFrame(0),
+    m_fft(vector< float >(), numberOfChannels % 2 == 1 ? frameSize : 2),
+    m_pairEngine(numberOfChannels >= 2 ? frameSize : 0),
+    m_pairInput(numberOfChannels >= 2 ? frameSize : 0),
+    m_pairResults(numberOfChannels >= 2 ? frameSize : 0),
+    m_spectra(frameSize/2 + 1, numberOfChannels)
+{
+    // a hop of zero never completes, and a longer one than the frame
+    // would leave samples out of every spectrum
+    if (hopSize == 0 || hopSize > frameSize){
+        throw InvalidHopSizeException();
+    }
+    m_spectra.numberOfChannels = numberOfChannels;
+}
+
+bool STFT::addFrames(const float *const *planar, size_t numberOfFrames){
+    const size_t frameSize = m_window.size();
+    const size_t firstSpan = min(numberOfFrames, frameSize - m_writeIndex);
+    for (size_t channel=0; channel<m_numberOfChannels; channel++){
+        const float *samples = planar[channel];
+        float *history = &m_history[channel * frameSize];
+        copy(samples, samples + firstSpan, history + m_writeIndex);
+        copy(samples + firstSpan, samples + numberOfFrames, history);
+    }
+    m_writeIndex += numberOfFrames;
+    if (m_writeIndex >= frameSize){
+        m_writeIndex -= frameSize;
+    }
+    m_samplesSinceLastFrame += numberOfFrames;
+    if (m_samplesSinceLastFrame == m_hopSize){
+        m_samplesSinceLastFrame = 0;
+        return true;
+    }
+    return false;
+}
+
+void STFT::computeSpectra(SpectrumFrame &spectra){
+    spectra.numberOfChannels = m_numberOfChannels;
+    size_t channel = 0;
+    for (; channel + 1 < m_numberOfChannels; channel += 2){
+        computePairSpectra(channel, spectra);
+    }
+    if (channel < m_numberOfChannels){
+        computeSingleSpectrum(channel, spectra);
+    }
+}
+
+void STFT::computeSingleSpectrum(size_t channel, SpectrumFrame &spectra){
+    const size_t frameSize = m_window.size();
+    const float *history = &m_history[channel * frameSize];
+    const size_t olderSpan = frameSize - m_writeIndex;
+
+    for (size_t i=0; i<olderSpan; i++){
+        m_fft.setValue(i, history[m_writeIndex + i] * m_window[i]);
+    }
+    for (size_t i=0; i<m_writeIndex; i++){
+        m_fft.setValue(olderSpan + i, history[i] * m_window[olderSpan + i]);
+    }
+    const vector< float > &amplitudes = m_fft.computeFrequentialAmplitudes();
+    copy(amplitudes.begin(), amplitudes.begin() + numberOfBins(), spectra.channels[channel].begin());
+}
+
+// With z = a + i*b and Z its transform of size n, the transforms of the two
+// real channels are :
+//   A[k] = (Z[k] + conj(Z[n-k])) / 2
+//   B[k] = (Z[k] - conj(Z[n-k])) / 2i
+void STFT::computePairSpectra(size_t firstChannel, SpectrumFrame &spectra){
+    const size_t frameSize = m_window.size();
+    const float *first = &m_history[firstChannel * frameSize];
+    const float *second = first + frameSize;
+    const size_t olderSpan = frameSize - m_writeIndex;
+
+    for (size_t i=0; i<olderSpan; i++){
+        m_pairInput[i] = complex< float >(first[m_writeIndex + i] * m_window[i],
+                                          second[m_writeIndex + i] * m_window[i]);
+    }
+    for (size_t i=0; i<m_writeIndex; i++){
+        m_pairInput[olderSpan + i] = complex< float >(first[i] * m_window[olderSpan + i],
+                                                      second[i] * m_window[olderSpan + i]);
+    }
+    m_pairEngine.eval(m_pairInput.data(), m_pairResults.data(), false);
+
+    vector< float > &firstAmplitudes = spectra.channels[firstChannel];
+    vector< float > &secondAmplitudes = spectra.channels[firstChannel + 1];
+    const bool withMidSide = (firstChannel == 0);
+    for (size_t k=0; k<numberOfBins(); k++){
+        const complex< float > zk = m_pairResults[k];
+        const complex< float > zmk = conj(m_pairResults[k == 0 ? 0 : frameSize-k]);
+        const complex< float > a = (zk + zmk) * 0.5f;
+        const complex< float > b = (zk - zmk) * complex< float >(0.0f, -0.5f);
+
+        firstAmplitudes[k] = abs(a);
+        secondAmplitudes[k] = abs(b);
+        if (withMidSide){
+            spectra.mid[k] = abs(a + b) * 0.5f;
+            spectra.side[k] = abs(a - b) * 0.5f;
+        }
+    }
+}
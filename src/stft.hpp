@@ -0,0 +1,108 @@
+#ifndef STFT_HPP
+#define STFT_HPP
+
+#include <vector>
+#include <exception>
+#include <cstddef>
+
+#include "fft.hpp"
+#include "spectrumframe.hpp"
+
+
+enum class WindowType {
+    rectangular,
+    hann,
+    blackmanHarris,   // 4 terms, -92 dB side lobes
+    flatTop           // accurate amplitudes, wide main lobe
+};
+
+// Periodic window of the given size, scaled so that its coherent gain is
+// the one of the rectangular window: a sine shows the same peak amplitude
+// whatever the window.
+std::vector< float > computeWindow(WindowType windowType, size_t size);
+
+
+// Short-time Fourier transform over a stream of samples. Every hopSize
+// samples, the spectrum of the latest frameSize samples is computed through
+// the window. Consecutive frames overlap by frameSize - hopSize samples
+// (frameSize/4 for 75% overlap), so the spectrum is updated more often than
+// the audio callbacks come without shortening the analysis frame.
+// The history is one ring per channel, written in place: each frame reads
+// it from the oldest sample in two spans, nothing is shifted or copied.
+//
+// The channels are transformed two by two: each pair is packed into one
+// complex FFT of frameSize points (the first channel in the real part, the
+// second in the imaginary part), which costs the same as two real FFTs, and
+// the spectra of both channels are untangled from it. An odd last channel,
+// a mono input for instance, goes through a real FFT. The mid and side
+// spectra of the first two channels are derived from theirs by linearity,
+// without any other transform.
+class STFT {
+public:
+    // Throws InvalidHopSizeException unless 0 < hopSize <= frameSize.
+    explicit STFT(size_t frameSize, size_t hopSize, WindowType windowType, size_t numberOfChannels = 1);
+
+    // Adds one sample per channel. Returns true when a hop is complete: the
+    // spectra of the latest frame can then be computed.
+    bool addFrame(const float *samples){
+        const size_t frameSize = m_window.size();
+        for (size_t channel=0; channel<m_numberOfChannels; channel++){
+            m_history[channel * frameSize + m_writeIndex] = samples[channel];
+        }
+        if (++m_writeIndex == frameSize){
+            m_writeIndex = 0;
+        }
+        if (++m_samplesSinceLastFrame == m_hopSize){
+            m_samplesSinceLastFrame = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // Same as addFrame for numberOfFrames samples of each channel, one
+    // buffer per channel. numberOfFrames must not exceed getFramesUntilHop().
+    bool addFrames(const float *const *planar, size_t numberOfFrames);
+
+    // Number of frames left before the end of the current hop.
+    size_t getFramesUntilHop() const { return m_hopSize - m_samplesSinceLastFrame; }
+
+    bool addSample(float sample){
+        return addFrame(&sample);
+    }
+
+    // Writes the spectra of the latest frame into spectra, whose vectors
+    // must already hold numberOfBins() values: nothing is allocated.
+    void computeSpectra(SpectrumFrame &spectra);
+
+    const SpectrumFrame &computeSpectra(){
+        computeSpectra(m_spectra);
+        return m_spectra;
+    }
+
+    // Spectrum of a mono input.
+    const std::vector< float > &computeFrequentialAmplitudes(){
+        return computeSpectra().channels[0];
+    }
+
+    size_t numberOfBins() const { return m_window.size()/2 + 1; }
+
+    class InvalidHopSizeException : std::exception {};
+
+private:
+    size_t m_numberOfChannels;
+    size_t m_hopSize;
+    std::vector< float > m_window;
+    std::vector< float > m_history;  // frameSize samples of each channel, one after the other
+    size_t m_writeIndex;            // also the oldest sample of the rings
+    size_t m_samplesSinceLastFrame;
+    RealFFTFloat m_fft;
+    FFTEngine< float > m_pairEngine;
+    std::vector< std::complex< float > > m_pairInput;
+    std::vector< std::complex< float > > m_pairResults;
+    SpectrumFrame m_spectra;
+
+    void computeSingleSpectrum(size_t channel, SpectrumFrame &spectra);
+    void computePairSpectra(size_t firstChannel, SpectrumFrame &spectra);
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+
+
+// Wait-free channel carrying the latest value from one producer thread to
+// one consumer thread, for feeds where only the newest snapshot matters
+// (what the GUI draws) and the intermediate ones can be skipped.
+// Of the three buffers, the producer owns the back one and fills it in
+// place, the consumer owns the front one, and the middle one is exchanged
+// atomically with either of them: publish hands the back buffer over,
+// update takes the newest published one. Nothing is copied nor allocated,
+// and each side never waits for the other.
+template < typename T >
+class TripleBuffer {
+public:
+    explicit TripleBuffer(const T &initialValue = T()) :
+        m_buffers{ {initialValue}, {initialValue}, {initialValue} },
+        m_middle(1),
+        m_backIndex(0),
+        m_frontIndex(2)
+    {}
+
+    // Producer : the buffer to fill, then publish it.
+    T &getBack(){
+        return m_buffers[m_backIndex].value;
+    }
+    void publish(){
+        m_backIndex = m_middle.exchange(m_backIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Consumer : makes the newest published value the front one. Returns
+    // false, and keeps the current front, when nothing new was published.
+    bool update(){
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH)){
+            return false;
+        }
+        m_frontIndex = m_middle.exchange(m_frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    const T &getFront() const {
+        return m_buffers[m_frontIndex].value;
+    }
+
+private:
+    static const size_t CACHE_LINE_SIZE = 64;
+    static const unsigned FRESH = 4;        // set in m_middle by publish, cleared by update
+    static const unsigned INDEX_MASK = 3;
+
+    struct alignas(CACHE_LINE_SIZE) Buffer {
+        T value;
+    };
+
+    Buffer m_buffers[3];
+    alignas(CACHE_LINE_SIZE) std::atomic< unsigned > m_middle;
+    alignas(CACHE_LINE_SIZE) unsigned m_backIndex;     // producer only
+    alignas(CACHE_LINE_SIZE) unsigned m_frontIndex;    // consumer only
+};
+
+#endif
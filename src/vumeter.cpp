@@ -1,41 +1,78 @@
 #include "vumeter.hpp"
 
 #include <iostream>
+#include <cstdlib>
 #include <thread>
 #include <unistd.h>
 #include <time.h>
 
 #include "listener.hpp"
 #include "displayer.hpp"
+#include "analyzer.hpp"
+#include "wavfilesource.hpp"
 
 using namespace std;
 
-const int RQ_QUEUE_INIT_SIZE = 100;
+const double SAMPLE_RING_SECONDS = 1.0;
+const size_t SPECTROGRAM_FEED_ROWS = 256;   // 2 s of hops at 16 kHz, for a display that stalls
 
-void VuMeter::audioThreadFunction(){
+unique_ptr<AudioSource> createAudioSource(const AudioSourceOptions &options){
+    switch (options.kind){
+    case AudioSourceOptions::Kind::wavFile:
+        return unique_ptr<AudioSource>(new WavFileSource(options.wavFileName, options.pacing));
+    case AudioSourceOptions::Kind::generator:
+        return unique_ptr<AudioSource>(new SignalGenerator(options.signalType, options.sampleRate, options.numberOfChannels,
+                                                           options.frequency, options.seconds, options.pacing));
+    case AudioSourceOptions::Kind::soundCard:
+        break;
+    }
     const string jabraSpeak510 = string("Jabra SPEAK 510 USB");
-    Listener(&m_lockFreeQueue, &m_lockFreeVectorQueue, true,
-             {jabraSpeak510,
-              "Soundflower (2ch)",
-              "Built-in Microphone"},
-             {jabraSpeak510, "Built-in Output"}).listenAndWrite();
+    return unique_ptr<AudioSource>(new Listener(true,
+                                                {jabraSpeak510,
+                                                 "Soundflower (2ch)",
+                                                 "Built-in Microphone"},
+                                                {jabraSpeak510, "Built-in Output"}));
+}
+
+void VuMeter::audioThreadFunction(){
+    m_audioSource->run(&m_sampleRing);
+    m_sampleRing.close();
+    cout << "End of the audio source" << endl;
+}
+
+void VuMeter::analysisThreadFunction(){
+    DisplayWakeup *displayWakeup = &m_displayWakeup;
+    Analyzer(&m_sampleRing, &m_analysisFeed, &m_spectrogramFeed, m_audioSource->getSampleRate(), m_monitorOptions,
+             [displayWakeup](){ displayWakeup->notify(); },
+             [displayWakeup](){ displayWakeup->notifyEndOfStream(); }).analyzeForever();
 }
 
 void VuMeter::guiThreadFunction(){
-    Displayer(&m_lockFreeQueue, &m_lockFreeVectorQueue).readAndDisplay();
+    Displayer(&m_analysisFeed, &m_spectrogramFeed, &m_displayWakeup, m_displayOptions).readAndDisplay();
 }
 
-VuMeter::VuMeter() :
-    m_lockFreeQueue(RQ_QUEUE_INIT_SIZE),
-    m_lockFreeVectorQueue(RQ_QUEUE_INIT_SIZE){
+VuMeter::VuMeter(const AudioSourceOptions &audioSourceOptions, const DisplayOptions &displayOptions,
+                 const MonitorOptions &monitorOptions) :
+    m_audioSource(createAudioSource(audioSourceOptions)),
+    m_analysisFeed(AnalysisFrame(Analyzer::getNumberOfSpectrumBins())),
+    m_spectrogramFeed(SPECTROGRAM_FEED_ROWS),
+    m_displayWakeup(),
+    m_displayOptions(displayOptions),
+    m_monitorOptions(monitorOptions),
+    m_sampleRing(SAMPLE_RING_SECONDS, m_audioSource->getSampleRate(), AnalysisFrame::MAX_NUMBER_OF_CHANNELS){
 }
 
 void VuMeter::start(){
     thread audioThread = thread(&VuMeter::audioThreadFunction, this);
+    thread analysisThread = thread(&VuMeter::analysisThreadFunction, this);
 
     // SDL says: "You should not expect to be able to create a window, render, or receive events on any thread other than the main one.""
     guiThreadFunction();
 
-    audioThread.join();
+    // The window has been closed, or the requested frames drawn: the audio and analysis threads never
+    // return on their own, so end the whole process here.
+    audioThread.detach();
+    analysisThread.detach();
+    exit(0);
 }
 
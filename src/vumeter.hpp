@@ -2,18 +2,49 @@
 #define VUMETER_HPP
 
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "rwqueuetype.hpp"
+#include "samplering.hpp"
+#include "displayer.hpp"
+#include "analyzer.hpp"
+#include "audiosource.hpp"
+#include "signalgenerator.hpp"
+
+
+// Where the VuMeter takes its samples. By default, the live input.
+struct AudioSourceOptions {
+    enum class Kind { soundCard, wavFile, generator };
+    Kind kind = Kind::soundCard;
+    Pacing pacing = Pacing::realTime;   // for the file and the generator
+    std::string wavFileName;
+    SignalType signalType = SignalType::sine;
+    double frequency = 1000.0;          // of the sine
+    double sampleRate = 16000.0;        // of the generator
+    size_t numberOfChannels = 1;        // of the generator
+    double seconds = 0.0;               // of the generator, 0 for never ending
+};
 
 
 class VuMeter {
 public:
-    VuMeter();
+    explicit VuMeter(const AudioSourceOptions &audioSourceOptions = AudioSourceOptions(),
+                     const DisplayOptions &displayOptions = DisplayOptions(),
+                     const MonitorOptions &monitorOptions = MonitorOptions());
     void start();
 private:
-    RWQueue m_lockFreeQueue;  // lock-free queue for Audio-Gui thread communication
-    RWVectorQueue m_lockFreeVectorQueue;
+    std::unique_ptr<AudioSource> m_audioSource;   // first: the ring is sized from its sample rate
+    AnalysisFeed m_analysisFeed;  // wait-free latest value for Analysis-Gui thread communication
+    SpectrogramFeed m_spectrogramFeed;   // every row of the spectrogram, same threads
+    DisplayWakeup m_displayWakeup;
+    DisplayOptions m_displayOptions;
+    MonitorOptions m_monitorOptions;
+    SampleRing m_sampleRing;  // raw samples, from the audio thread to the analysis thread
 
     void audioThreadFunction();
+    void analysisThreadFunction();
     void guiThreadFunction();
 };
 
@@ -0,0 +1,163 @@
+#include "wavfile.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+
+const uint16_t WAVE_FORMAT_PCM = 0x0001;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+const size_t MAX_NUMBER_OF_CHANNELS = 16;   // as many as an AnalysisFrame holds
+
+// WAV files are little endian, whatever the machine.
+static uint16_t readUint16(const uint8_t *bytes){
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t readUint32(const uint8_t *bytes){
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+WavFile::WavFile(const string &fileName) :
+    m_fileDescriptor(-1),
+    m_mapping(nullptr),
+    m_mappingSize(0),
+    m_sampleFormat(SampleFormat::pcm),
+    m_numberOfChannels(0),
+    m_sampleRate(0.0),
+    m_bytesPerSample(0),
+    m_data(nullptr),
+    m_numberOfFrames(0)
+{
+    // the destructor is not called when the constructor throws
+    try {
+        m_fileDescriptor = open(fileName.c_str(), O_RDONLY);
+        struct stat fileStatus;
+        if (m_fileDescriptor < 0 || fstat(m_fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0){
+            cout << "Unable to open " << fileName << ": " << strerror(errno) << endl;
+            throw CannotOpenFileException();
+        }
+        m_mappingSize = (size_t)fileStatus.st_size;
+        void *mapping = mmap(nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+        if (mapping == MAP_FAILED){
+            cout << "Unable to map " << fileName << ": " << strerror(errno) << endl;
+            throw CannotOpenFileException();
+        }
+        m_mapping = (const uint8_t *)mapping;
+        // each part of the file is read once, from start to end
+        madvise(mapping, m_mappingSize, MADV_SEQUENTIAL);
+
+        parseHeader(fileName);
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+WavFile::~WavFile(){
+    unmap();
+}
+
+void WavFile::unmap(){
+    if (m_mapping){
+        munmap((void *)m_mapping, m_mappingSize);
+    }
+    if (m_fileDescriptor >= 0){
+        close(m_fileDescriptor);
+    }
+    m_mapping = nullptr;
+    m_fileDescriptor = -1;
+}
+
+// RIFF header, then chunks of (id, size, content) padded to an even size:
+// the format comes from "fmt ", the samples from "data", the others are
+// skipped.
+void WavFile::parseHeader(const string &fileName){
+    if (m_mappingSize < 12 || memcmp(m_mapping, "RIFF", 4) != 0 || memcmp(m_mapping + 8, "WAVE", 4) != 0){
+        cout << fileName << " is not a WAV file" << endl;
+        throw UnsupportedFormatException();
+    }
+
+    uint16_t formatTag = 0;
+    size_t bitsPerSample = 0;
+    size_t dataSize = 0;
+    bool hasFormat = false;
+    size_t position = 12;
+    while (position + 8 <= m_mappingSize && !m_data){
+        const uint8_t *chunk = m_mapping + position;
+        const size_t chunkSize = readUint32(chunk + 4);
+        const uint8_t *content = chunk + 8;
+        const size_t contentSize = min(chunkSize, m_mappingSize - position - 8);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && contentSize >= 16){
+            formatTag = readUint16(content);
+            m_numberOfChannels = readUint16(content + 2);
+            m_sampleRate = readUint32(content + 4);
+            bitsPerSample = readUint16(content + 14);
+            if (formatTag == WAVE_FORMAT_EXTENSIBLE && contentSize >= 26){
+                // the first two bytes of the sub format GUID are the format tag
+                formatTag = readUint16(content + 24);
+            }
+            hasFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0){
+            m_data = content;
+            dataSize = contentSize;   // a truncated file plays what it has
+        }
+        if (chunkSize >= m_mappingSize - position - 8){
+            break;
+        }
+        position += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    m_bytesPerSample = bitsPerSample / 8;
+    const bool supportedPcm = (formatTag == WAVE_FORMAT_PCM && bitsPerSample >= 8 && bitsPerSample <= 32 && bitsPerSample % 8 == 0);
+    const bool supportedFloat = (formatTag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 32);
+    if (!hasFormat || !m_data || !(supportedPcm || supportedFloat)
+        || m_numberOfChannels == 0 || m_numberOfChannels > MAX_NUMBER_OF_CHANNELS || m_sampleRate <= 0){
+        cout << fileName << ": unsupported WAV format (tag " << formatTag << ", " << m_numberOfChannels
+             << " channels, " << bitsPerSample << " bits)" << endl;
+        throw UnsupportedFormatException();
+    }
+    m_sampleFormat = supportedFloat ? SampleFormat::ieeeFloat : SampleFormat::pcm;
+    m_numberOfFrames = dataSize / (m_bytesPerSample * m_numberOfChannels);
+}
+
+float WavFile::decodeSample(const uint8_t *sample) const {
+    if (m_sampleFormat == SampleFormat::ieeeFloat){
+        const uint32_t bits = readUint32(sample);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    switch (m_bytesPerSample){
+    case 1:
+        // 8 bits PCM is the only unsigned one
+        return ((int)sample[0] - 128) / 128.0f;
+    case 2:
+        return (int16_t)readUint16(sample) / 32768.0f;
+    case 3:
+        // the 24 bits go to the top of an int32, which sign extends them
+        return (int32_t)(((uint32_t)sample[0] << 8) | ((uint32_t)sample[1] << 16) | ((uint32_t)sample[2] << 24)) / 2147483648.0f;
+    default:
+        return (int32_t)readUint32(sample) / 2147483648.0f;
+    }
+}
+
+size_t WavFile::readFrames(size_t firstFrame, float *samples, size_t numberOfFrames) const {
+    const size_t framesRead = (firstFrame < m_numberOfFrames) ? min(numberOfFrames, m_numberOfFrames - firstFrame) : 0;
+    const size_t count = framesRead * m_numberOfChannels;
+    const uint8_t *sample = m_data + firstFrame * m_numberOfChannels * m_bytesPerSample;
+    for (size_t i=0; i<count; i++, sample += m_bytesPerSample){
+        samples[i] = decodeSample(sample);
+    }
+    return framesRead;
+}
@@ -0,0 +1,52 @@
+#ifndef WAV_FILE_HPP
+#define WAV_FILE_HPP
+
+#include <string>
+#include <exception>
+#include <cstddef>
+#include <cstdint>
+
+
+// A WAV file mapped in memory. The samples are converted to float on
+// demand, straight from the mapping: nothing is read or copied ahead, and
+// any number of threads can read different parts of the file at once.
+// Supported: PCM on 8, 16, 24 or 32 bits and IEEE float on 32 bits, plain
+// or WAVE_FORMAT_EXTENSIBLE, up to 16 channels.
+class WavFile {
+public:
+    explicit WavFile(const std::string &fileName);
+    ~WavFile();
+
+    size_t getNumberOfChannels() const { return m_numberOfChannels; }
+    double getSampleRate() const { return m_sampleRate; }
+    size_t getBitsPerSample() const { return m_bytesPerSample * 8; }
+    size_t getNumberOfFrames() const { return m_numberOfFrames; }
+
+    // Writes the interleaved samples of up to numberOfFrames frames from
+    // firstFrame on, and returns how many frames there were.
+    size_t readFrames(size_t firstFrame, float *samples, size_t numberOfFrames) const;
+
+    class CannotOpenFileException : std::exception {};
+    class UnsupportedFormatException : std::exception {};
+
+private:
+    enum class SampleFormat { pcm, ieeeFloat };
+
+    int m_fileDescriptor;
+    const uint8_t *m_mapping;
+    size_t m_mappingSize;
+
+    SampleFormat m_sampleFormat;
+    size_t m_numberOfChannels;
+    double m_sampleRate;
+    size_t m_bytesPerSample;
+    const uint8_t *m_data;         // first sample of the data chunk
+    size_t m_numberOfFrames;
+
+    WavFile(const WavFile &);
+    void parseHeader(const std::string &fileName);
+    void unmap();
+    float decodeSample(const uint8_t *sample) const;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "wavfilesource.hpp"
+
+#include <iostream>
+
+using namespace std;
+
+
+WavFileSource::WavFileSource(const string &fileName, Pacing pacing) :
+    BlockAudioSource(pacing),
+    m_wavFile(fileName),
+    m_nextFrame(0)
+{
+    cout << fileName << ": " << m_wavFile.getNumberOfChannels() << " channels, " << m_wavFile.getSampleRate() << " Hz, "
+         << m_wavFile.getBitsPerSample() << " bits, " << (double)m_wavFile.getNumberOfFrames() / m_wavFile.getSampleRate() << " s" << endl;
+}
+
+size_t WavFileSource::readFrames(float *samples, size_t numberOfFrames){
+    const size_t framesRead = m_wavFile.readFrames(m_nextFrame, samples, numberOfFrames);
+    m_nextFrame += framesRead;
+    return framesRead;
+}
@@ -0,0 +1,27 @@
+#ifndef WAV_FILE_SOURCE_HPP
+#define WAV_FILE_SOURCE_HPP
+
+#include <string>
+#include <cstddef>
+
+#include "audiosource.hpp"
+#include "wavfile.hpp"
+
+
+// Plays a WAV file into the ring, once.
+class WavFileSource : public BlockAudioSource {
+public:
+    explicit WavFileSource(const std::string &fileName, Pacing pacing);
+
+    double getSampleRate() const override { return m_wavFile.getSampleRate(); }
+
+protected:
+    size_t getNumberOfChannels() const override { return m_wavFile.getNumberOfChannels(); }
+    size_t readFrames(float *samples, size_t numberOfFrames) override;
+
+private:
+    WavFile m_wavFile;
+    size_t m_nextFrame;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "workstealingpool.hpp"
+
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+
+// The worker running the current thread, one pool per thread at most.
+static thread_local const WorkStealingPool *currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+
+WorkStealingPool::WorkStealingPool(size_t numberOfWorkers, bool pinWorkers) :
+    m_workers(),
+    m_threads(),
+    m_queuedTasks(0),
+    m_pendingTasks(0),
+    m_stopping(false)
+{
+    numberOfWorkers = max((size_t)1, numberOfWorkers);
+    for (size_t i=0; i<numberOfWorkers; i++){
+        m_workers.push_back(unique_ptr< Worker >(new Worker()));
+        m_workers.back()->executedTasks.store(0);
+        m_workers.back()->stolenTasks.store(0);
+    }
+    for (size_t i=0; i<numberOfWorkers; i++){
+        m_threads.push_back(thread(&WorkStealingPool::workerLoop, this, i, pinWorkers));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool(){
+    waitForAll();
+    {
+        lock_guard< mutex > lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_tasksQueued.notify_all();
+    for (thread &t : m_threads){
+        t.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task, size_t affinityHint){
+    Worker &worker = *m_workers[affinityHint % m_workers.size()];
+    m_pendingTasks.fetch_add(1);
+    {
+        // counted before it can be popped, so that the count never goes
+        // below zero
+        lock_guard< mutex > lock(worker.mutex);
+        m_queuedTasks.fetch_add(1);
+        worker.tasks.push_back(move(task));
+    }
+    {
+        // a worker about to sleep has either seen the count already, or
+        // is waiting by the time we notify it
+        lock_guard< mutex > lock(m_sleepMutex);
+    }
+    m_tasksQueued.notify_one();
+}
+
+void WorkStealingPool::waitForAll(){
+    unique_lock< mutex > lock(m_sleepMutex);
+    m_allDone.wait(lock, [this](){ return m_pendingTasks.load() == 0; });
+}
+
+WorkStealingStatistics WorkStealingPool::getStatistics() const {
+    WorkStealingStatistics statistics = { 0, 0 };
+    for (const unique_ptr< Worker > &worker : m_workers){
+        statistics.executedTasks += worker->executedTasks.load(memory_order_relaxed);
+        statistics.stolenTasks += worker->stolenTasks.load(memory_order_relaxed);
+    }
+    return statistics;
+}
+
+size_t WorkStealingPool::getCurrentWorker() const {
+    return (currentPool == this) ? currentWorker : m_workers.size();
+}
+
+void WorkStealingPool::workerLoop(size_t index, bool pin){
+    currentPool = this;
+    currentWorker = index;
+#ifdef __linux__
+    if (pin){
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % max(1u, thread::hardware_concurrency()), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#else
+    (void)pin;
+#endif
+
+    Task task;
+    while (true){
+        if (popOwnTask(index, task)){
+            runTask(index, task, false);
+        } else if (stealTask(index, task)){
+            runTask(index, task, true);
+        } else {
+            unique_lock< mutex > lock(m_sleepMutex);
+            m_tasksQueued.wait(lock, [this](){ return m_queuedTasks.load() > 0 || m_stopping; });
+            if (m_stopping && m_queuedTasks.load() == 0){
+                return;
+            }
+        }
+    }
+}
+
+// The newest task of the worker.
+bool WorkStealingPool::popOwnTask(size_t index, Task &task){
+    Worker &worker = *m_workers[index];
+    lock_guard< mutex > lock(worker.mutex);
+    if (worker.tasks.empty()){
+        return false;
+    }
+    task = move(worker.tasks.back());
+    worker.tasks.pop_back();
+    m_queuedTasks.fetch_sub(1);
+    return true;
+}
+
+// The oldest task of the first other worker that has one.
+bool WorkStealingPool::stealTask(size_t thief, Task &task){
+    for (size_t i=1; i<m_workers.size(); i++){
+        Worker &victim = *m_workers[(thief + i) % m_workers.size()];
+        lock_guard< mutex > lock(victim.mutex);
+        if (!victim.tasks.empty()){
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::runTask(size_t index, Task &task, bool stolen){
+    task();
+    task = nullptr;
+
+    Worker &worker = *m_workers[index];
+    worker.executedTasks.store(worker.executedTasks.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    if (stolen){
+        worker.stolenTasks.store(worker.stolenTasks.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+    if (m_pendingTasks.fetch_sub(1) == 1){
+        lock_guard< mutex > lock(m_sleepMutex);
+        m_allDone.notify_all();
+    }
+}
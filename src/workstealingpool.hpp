@@ -0,0 +1,82 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+
+// Counters of a WorkStealingPool, since it was created.
+struct WorkStealingStatistics {
+    uint64_t executedTasks;
+    uint64_t stolenTasks;   // executed by another worker than the one they were given to
+};
+
+// Executor for the analysis of many independent streams. Each worker
+// thread has its own deque of tasks, so the workers do not contend on a
+// shared queue:
+//  - a task goes to the worker given by its affinity hint, which keeps the
+//    tasks of a stream on the same core, with its data in that cache,
+//  - a worker runs its own newest task first, the one whose data is the
+//    most likely to still be in its cache,
+//  - a worker whose deque is empty steals the oldest task of another one,
+//    trying the next workers in turn so that the thieves spread out.
+// Idle workers sleep until tasks are submitted. Optionally, each worker is
+// pinned to a core (Linux only, elsewhere the hint stays a hint).
+class WorkStealingPool {
+public:
+    typedef std::function< void() > Task;
+
+    explicit WorkStealingPool(size_t numberOfWorkers, bool pinWorkers);
+    ~WorkStealingPool();   // runs the remaining tasks first
+
+    size_t getNumberOfWorkers() const { return m_workers.size(); }
+
+    // Any thread, tasks included. The task goes to the worker
+    // affinityHint modulo the number of workers.
+    void submit(Task task, size_t affinityHint);
+
+    // Any thread but the workers. Returns when every submitted task is done.
+    void waitForAll();
+
+    WorkStealingStatistics getStatistics() const;
+
+    // Index of the worker running the caller, or getNumberOfWorkers() when
+    // it is not one of them: tasks can use it to pick per-worker buffers.
+    size_t getCurrentWorker() const;
+
+private:
+    // Allocated one by one; the padding keeps the next allocation off the
+    // cache line of the counters (alignas would need C++17 to apply to new).
+    struct Worker {
+        std::mutex mutex;
+        std::deque< Task > tasks;
+        std::atomic< uint64_t > executedTasks;
+        std::atomic< uint64_t > stolenTasks;
+        char padding[64];
+    };
+
+    std::vector< std::unique_ptr< Worker > > m_workers;
+    std::vector< std::thread > m_threads;
+
+    std::atomic< size_t > m_queuedTasks;    // in the deques
+    std::atomic< size_t > m_pendingTasks;   // submitted and not done yet
+    bool m_stopping;
+    std::mutex m_sleepMutex;                // guards m_stopping, and the sleeps below
+    std::condition_variable m_tasksQueued;
+    std::condition_variable m_allDone;
+
+    void workerLoop(size_t index, bool pin);
+    bool popOwnTask(size_t index, Task &task);
+    bool stealTask(size_t thief, Task &task);
+    void runTask(size_t index, Task &task, bool stolen);
+};
+
+#endif